@@ -0,0 +1,784 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <yarp/os/ResourceFinder.h>
+#include <yarp/os/Value.h>
+#include <gsl/gsl_integration.h>
+#include "problem.h"
+#include "arclength.h"
+#include "solver.h"
+#include "contact.h"
+#include "generator.h"
+
+using namespace std;
+using namespace yarp::os;
+using namespace problem_ns;
+
+namespace {
+
+/***************************************************/
+struct Record {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+// results of the suite, printed at the end
+vector<Record> records;
+
+// seed of the corpora
+unsigned int seed=1;
+
+// sink preventing the compiler from optimizing away the measured calls
+volatile double sink;
+
+/***************************************************/
+void report(const string &name, const double value, const string &unit)
+{
+    records.push_back(Record{name,value,unit});
+}
+
+/***************************************************/
+void print_text(ostream &out)
+{
+    size_t width=0;
+    for (auto &r:records) {
+        width=std::max(width,r.name.size());
+    }
+    for (auto &r:records) {
+        out << left << setw(width+2) << r.name << r.value << " " << r.unit << endl;
+    }
+}
+
+/***************************************************/
+void print_json(ostream &out)
+{
+    out << "{" << endl;
+    out << "  \"seed\": " << seed << "," << endl;
+    out << "  \"results\": [" << endl;
+    for (size_t i=0; i<records.size(); i++) {
+        auto &r=records[i];
+        out << "    {\"name\": \"" << r.name << "\", \"value\": " << setprecision(10)
+            << (std::isfinite(r.value)?r.value:0.) << ", \"unit\": \"" << r.unit << "\"}"
+            << (i+1<records.size()?",":"") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+}
+
+/***************************************************/
+double percentile(vector<double> samples, const double p)
+{
+    // nearest-rank method
+    if (samples.empty()) {
+        return 0.;
+    }
+    sort(begin(samples),end(samples));
+    auto rank=(size_t)ceil(p*samples.size());
+    return samples[std::min(samples.size(),std::max<size_t>(rank,1))-1];
+}
+
+/***************************************************/
+double integrand_M(double t, void* params)
+{
+    auto problem=static_cast<const Problem*>(params);
+    return (sqrt(norm2(problem->eval_P(t)))/2.);
+}
+
+/***************************************************/
+double integrand_COMx(double t, void* params)
+{
+    auto problem=static_cast<const Problem*>(params);
+    return ((norm2(problem->eval_P(t))*cos(t))/3.);
+}
+
+/***************************************************/
+double integrand_COMy(double t, void* params)
+{
+    auto problem=static_cast<const Problem*>(params);
+    return ((norm2(problem->eval_P(t))*sin(t))/3.);
+}
+
+/***************************************************/
+Vec2 calc_COM_adaptive(const Problem& problem)
+{
+    // reference: three adaptive passes, as originally done within configure()
+    size_t limit=10000;
+    auto ws=gsl_integration_workspace_alloc(limit);
+    gsl_function integrand;
+    integrand.params=const_cast<void*>(static_cast<const void*>(&problem));
+
+    double epsabs=.0001;
+    double epsrel=.001;
+    double abserr;
+
+    double area;
+    integrand.function=&integrand_M;
+    gsl_integration_qag(&integrand,0.,2.*M_PI,epsabs,epsrel,limit,GSL_INTEG_GAUSS61,ws,&area,&abserr);
+
+    Vec2 COM;
+    integrand.function=&integrand_COMx;
+    gsl_integration_qag(&integrand,0.,2.*M_PI,epsabs,epsrel,limit,GSL_INTEG_GAUSS61,ws,&COM.x,&abserr);
+
+    integrand.function=&integrand_COMy;
+    gsl_integration_qag(&integrand,0.,2.*M_PI,epsabs,epsrel,limit,GSL_INTEG_GAUSS61,ws,&COM.y,&abserr);
+
+    gsl_integration_workspace_free(ws);
+    return COM/area;
+}
+
+/***************************************************/
+template<typename Fn>
+double measure_us(const int repetitions, Fn &&fn)
+{
+    auto t0=chrono::steady_clock::now();
+    for (int i=0; i<repetitions; i++) {
+        fn();
+    }
+    auto t1=chrono::steady_clock::now();
+    return chrono::duration<double,micro>(t1-t0).count()/repetitions;
+}
+
+/***************************************************/
+vector<shared_ptr<Problem>> make_corpus(const string &type, const int num_problems)
+{
+    // seeded streams, so that the corpora are identical across runs
+    Generator generator(seed+(type=="circle"?0:1));
+    vector<shared_ptr<Problem>> problems;
+    for (int n=0; n<num_problems; n++) {
+        auto problem=make_shared<Problem>();
+        generator.generate(*problem);
+        if (type=="circle") {
+            auto F=problem->get_F(); F.ft=0.;
+            problem->configure(vector<double>(4,0.),problem->get_friction(),F);
+        }
+        problems.push_back(problem);
+    }
+    return problems;
+}
+
+/***************************************************/
+bool success(const Problem& problem, const vector<Force>& forces)
+{
+    auto F_T=problem.compute_newton_law(forces);
+    return ((hypot(F_T.first[0],F_T.first[1])<.01) && (fabs(F_T.second)<.01) &&
+            problem.check_no_slippage(forces));
+}
+
+/***************************************************/
+void bench_configure(const int num_problems, const int repetitions)
+{
+    double t_fused=0., t_adaptive=0., err=0.;
+    for (auto &problem:make_corpus("patch",num_problems)) {
+        auto shape=problem->get_shape();
+        auto friction=problem->get_friction();
+        auto F=problem->get_F();
+
+        t_fused+=measure_us(repetitions,[&]() { problem->configure(shape,friction,F); });
+        Vec2 COM;
+        t_adaptive+=measure_us(repetitions,[&]() { COM=calc_COM_adaptive(*problem); });
+        err=std::max(err,norm(COM-problem->eval_COM()));
+    }
+
+    t_fused/=num_problems;
+    t_adaptive/=num_problems;
+    report("configure",t_fused,"us");
+    report("configure.COM_adaptive_reference",t_adaptive,"us");
+    report("configure.COM_max_error",err,"abs");
+}
+
+/***************************************************/
+void bench_geometry(const int num_problems, const int repetitions)
+{
+    auto problems=make_corpus("patch",num_problems);
+    const int num_samples=1000;
+    vector<double> t(num_samples);
+    for (int i=0; i<num_samples; i++) {
+        t[i]=(2.*M_PI*i)/num_samples;
+    }
+
+    auto run=[&](const string &name, const function<double(const Problem&, const double)> &fn) {
+        double us=0.;
+        for (auto &problem:problems) {
+            us+=measure_us(repetitions,[&]() {
+                double acc=0.;
+                for (auto &ti:t) {
+                    acc+=fn(*problem,ti);
+                }
+                sink=acc;
+            });
+        }
+        report("geometry."+name,(1e3*us)/(num_problems*num_samples),"ns/call");
+    };
+    run("get_P",[](const Problem& p, const double t) { return p.get_P(t)[0]; });
+    run("get_dP",[](const Problem& p, const double t) { return p.get_dP(t)[0]; });
+    run("get_N",[](const Problem& p, const double t) { return p.get_N(t)[0]; });
+    run("eval_P",[](const Problem& p, const double t) { return p.eval_P(t).x; });
+    run("eval_frame",[](const Problem& p, const double t) { return p.eval_frame(t).N.x; });
+
+    vector<double> buf(6*num_samples);
+    SamplesSoA out{&buf[0],&buf[num_samples],&buf[2*num_samples],&buf[3*num_samples],
+                   &buf[4*num_samples],&buf[5*num_samples]};
+    double us=0.;
+    for (auto &problem:problems) {
+        us+=measure_us(repetitions,[&]() { problem->eval_batch(t.data(),t.size(),out); sink=buf[0]; });
+    }
+    report("geometry.eval_batch",(1e3*us)/(num_problems*num_samples),"ns/sample");
+}
+
+/***************************************************/
+void bench_arc_length(const int num_problems, const int repetitions)
+{
+    auto problems=make_corpus("patch",num_problems);
+    const int num_samples=1000;
+    double us_build=0., us_s=0., us_t=0., err=0.;
+    for (auto &problem:problems) {
+        us_build+=measure_us(repetitions,[&]() { ArcLength arc(*problem); sink=arc.get_length(); });
+        ArcLength arc(*problem);
+        auto L=arc.get_length();
+        us_s+=measure_us(repetitions,[&]() {
+            double acc=0.;
+            for (int i=0; i<num_samples; i++) {
+                acc+=arc.eval_length((2.*M_PI*i)/num_samples);
+            }
+            sink=acc;
+        });
+        us_t+=measure_us(repetitions,[&]() {
+            double acc=0.;
+            for (int i=0; i<num_samples; i++) {
+                acc+=arc.eval_angle((L*i)/num_samples);
+            }
+            sink=acc;
+        });
+        for (int i=0; i<num_samples; i++) {
+            auto s=(L*i)/num_samples;
+            err=std::max(err,fabs(arc.eval_length(arc.eval_angle(s))-s)/L);
+        }
+    }
+    report("arc_length.build",us_build/num_problems,"us");
+    report("arc_length.eval_length",(1e3*us_s)/(num_problems*num_samples),"ns/call");
+    report("arc_length.eval_angle",(1e3*us_t)/(num_problems*num_samples),"ns/call");
+    report("arc_length.round_trip_error",err,"rel");
+}
+
+/***************************************************/
+void bench_newton_law(const int num_problems, const int repetitions)
+{
+    auto problems=make_corpus("patch",num_problems);
+    mt19937 rng(seed);
+    uniform_real_distribution<double> dist_t(0.,2.*M_PI);
+    uniform_real_distribution<double> dist_f(0.,1.);
+
+    double us=0.;
+    for (auto &problem:problems) {
+        vector<Force> forces(2);
+        for (auto &f:forces) {
+            f.t=dist_t(rng);
+            f.fn=dist_f(rng);
+            f.ft=dist_f(rng)-.5;
+        }
+        us+=measure_us(repetitions,[&]() { sink=problem->compute_newton_law(forces).second; });
+    }
+    report("compute_newton_law",us/num_problems,"us");
+}
+
+/***************************************************/
+struct ContactDerivatives {
+    double grad[3][3];
+    double hess[3][3];
+};
+
+/***************************************************/
+void hand_derivatives(const Problem& problem, const Force& f, ContactDerivatives& d,
+                      const bool hessian)
+{
+    // hand-written derivatives of <Fx,Fy,T> wrt <t,fn,ft>, built on eval_frame()
+    auto frame=problem.eval_frame(f.t);
+    auto r=frame.P-problem.eval_COM();
+    auto Fi=f.fn*frame.N+f.ft*frame.T;
+    auto dFi=f.fn*frame.dN+f.ft*frame.dT;
+    Vec2 dF[3]={dFi,frame.N,frame.T};
+    double dT[3]={cross(frame.dP,Fi)+cross(r,dFi),cross(r,frame.N),cross(r,frame.T)};
+    for (size_t k=0; k<3; k++) {
+        d.grad[0][k]=dF[k].x;
+        d.grad[1][k]=dF[k].y;
+        d.grad[2][k]=dT[k];
+    }
+    if (hessian) {
+        auto d2Fi=f.fn*frame.d2N+f.ft*frame.d2T;
+        Vec2 d2F[3]={d2Fi,frame.dN,frame.dT};
+        double d2T[3]={cross(frame.d2P,Fi)+2.*cross(frame.dP,dFi)+cross(r,d2Fi),
+                       cross(frame.dP,frame.N)+cross(r,frame.dN),
+                       cross(r,frame.dT)};
+        for (size_t k=0; k<3; k++) {
+            d.hess[0][k]=d2F[k].x;
+            d.hess[1][k]=d2F[k].y;
+            d.hess[2][k]=d2T[k];
+        }
+    }
+}
+
+/***************************************************/
+template<size_t N>
+void jet_derivatives(const Problem& problem, const Force& f, ContactDerivatives& d)
+{
+    auto jet=problem.eval_wrench_jet<N>(f.t);
+    for (size_t j=0; j<3; j++) {
+        auto w=f.fn*jet.normal[j]+f.ft*jet.tangential[j];
+        d.grad[j][0]=w.derivative(1);
+        d.grad[j][1]=jet.normal[j].value();
+        d.grad[j][2]=jet.tangential[j].value();
+        if (N>1) {
+            d.hess[j][0]=w.derivative(2);
+            d.hess[j][1]=jet.normal[j].derivative(1);
+            d.hess[j][2]=jet.tangential[j].derivative(1);
+        }
+    }
+}
+
+/***************************************************/
+void bench_autodiff(const int num_problems, const int repetitions)
+{
+    // derivatives worked out by eval_wrench_jet() against the hand-written ones
+    const size_t num_contacts=64;
+    auto problems=make_corpus("patch",num_problems);
+    mt19937 rng(seed);
+    uniform_real_distribution<double> dist_t(0.,2.*M_PI);
+    uniform_real_distribution<double> dist_f(0.,1.);
+
+    double t_hand_grad=0., t_hand_hess=0., t_jet_grad=0., t_jet_hess=0., err=0.;
+    vector<Force> forces(num_contacts);
+    ContactDerivatives hand, jet;
+    for (auto &problem:problems) {
+        for (auto &f:forces) {
+            f.t=dist_t(rng);
+            f.fn=dist_f(rng);
+            f.ft=dist_f(rng)-.5;
+        }
+        auto run=[&](const function<void(const Force&)> &fn) {
+            return measure_us(repetitions,[&]() {
+                for (auto &f:forces) {
+                    fn(f);
+                }
+                sink=hand.grad[2][0]+jet.grad[2][0];
+            });
+        };
+        t_hand_grad+=run([&](const Force& f) { hand_derivatives(*problem,f,hand,false); });
+        t_jet_grad+=run([&](const Force& f) { jet_derivatives<1>(*problem,f,jet); });
+        t_hand_hess+=run([&](const Force& f) { hand_derivatives(*problem,f,hand,true); });
+        t_jet_hess+=run([&](const Force& f) { jet_derivatives<2>(*problem,f,jet); });
+
+        for (auto &f:forces) {
+            hand_derivatives(*problem,f,hand,true);
+            jet_derivatives<2>(*problem,f,jet);
+            for (size_t j=0; j<3; j++) {
+                for (size_t k=0; k<3; k++) {
+                    err=std::max(err,fabs(hand.grad[j][k]-jet.grad[j][k]));
+                    err=std::max(err,fabs(hand.hess[j][k]-jet.hess[j][k]));
+                }
+            }
+        }
+    }
+
+    auto ns=1e3/(num_problems*num_contacts);
+    report("autodiff.gradient.hand",ns*t_hand_grad,"ns/contact");
+    report("autodiff.gradient.dual",ns*t_jet_grad,"ns/contact");
+    report("autodiff.hessian.hand",ns*t_hand_hess,"ns/contact");
+    report("autodiff.hessian.dual",ns*t_jet_hess,"ns/contact");
+    report("autodiff.max_error",err,"abs");
+}
+
+/***************************************************/
+void bench_generate(const int num_problems, const int repetitions)
+{
+    auto us=measure_us(repetitions,[]() { sink=Problem::generate()->get_friction(); });
+    report("generate.Problem",us,"us");
+
+    Generator generator(seed);
+    Problem problem;
+    us=measure_us(repetitions,[&]() { generator.generate(problem); sink=problem.get_friction(); });
+    report("generate.Generator",us,"us");
+
+    vector<Problem> problems(num_problems*repetitions);
+    ThreadPool pool;
+    us=measure_us(1,[&]() { generator.generate_n(problems,&pool); });
+    report("generate.Generator_n.workers_"+to_string(pool.size()),
+           problems.size()/(us*1e-6),"problems/s");
+}
+
+/***************************************************/
+void bench_latency(const int num_problems)
+{
+    for (auto &type:{"circle","patch"}) {
+        auto problems=make_corpus(type,num_problems);
+        Solver solver;
+        vector<double> samples;
+        int successes=0;
+        for (auto &problem:problems) {
+            vector<Force> forces;
+            samples.push_back(measure_us(1,[&]() { forces=solver.compute(*problem); }));
+            successes+=(success(*problem,forces)?1:0);
+        }
+
+        auto prefix=string("latency.")+type;
+        report(prefix+".p50",percentile(samples,.5),"us");
+        report(prefix+".p99",percentile(samples,.99),"us");
+        report(prefix+".max",*max_element(begin(samples),end(samples)),"us");
+        report(prefix+".successes",successes,"problems");
+    }
+}
+
+/***************************************************/
+void bench_deadline(const int num_problems)
+{
+    auto problems=make_corpus("patch",num_problems);
+    Solver solver;
+    for (auto budget_us:{500,1000,2000,5000}) {
+        vector<double> samples;
+        int successes=0;
+        int quality[3]={0,0,0};
+        for (auto &problem:problems) {
+            vector<Force> forces;
+            samples.push_back(measure_us(1,[&]() { forces=solver.compute_within(*problem,1e-6*budget_us); }));
+            successes+=(success(*problem,forces)?1:0);
+            quality[(int)solver.get_stats().quality]++;
+        }
+
+        auto prefix="deadline.budget_"+to_string(budget_us)+"us";
+        report(prefix+".p50",percentile(samples,.5),"us");
+        report(prefix+".p99",percentile(samples,.99),"us");
+        report(prefix+".max",*max_element(begin(samples),end(samples)),"us");
+        report(prefix+".converged",quality[(int)SolveQuality::converged],"problems");
+        report(prefix+".feasible",quality[(int)SolveQuality::feasible],"problems");
+        report(prefix+".fallback",quality[(int)SolveQuality::fallback],"problems");
+        report(prefix+".successes",successes,"problems");
+    }
+}
+
+/***************************************************/
+void bench_tracking(const int num_problems)
+{
+    // streams of loads drifting slowly, as sampled by a control loop
+    const int num_streams=std::max(1,num_problems/10);
+    const int num_ticks=100;
+    for (auto warm:{false,true}) {
+        auto problems=make_corpus("patch",num_streams);
+        mt19937 rng(seed);
+        normal_distribution<double> drift(0.,.002);
+        Solver solver;
+        // the first tick of each stream has nothing to warm-start from,
+        // hence per-tick figures are taken over the following ticks
+        vector<double> samples, iterations;
+        int successes=0;
+        double first_us=0.;
+        for (auto &problem:problems) {
+            auto friction=problem->get_friction();
+            auto F=problem->get_F();
+            for (int tick=0; tick<num_ticks; tick++) {
+                F.t+=drift(rng);
+                F.fn*=1.+drift(rng);
+                friction=std::max(0.,std::min(friction*(1.+drift(rng)),1.));
+                vector<Force> forces;
+                auto us=measure_us(1,[&]() {
+                    if (warm) {
+                        forces=solver.track(*problem,friction,F);
+                    } else {
+                        problem->configure_load(friction,F);
+                        forces=solver.compute(*problem,vector<Force>());
+                    }
+                });
+                if (tick>0) {
+                    samples.push_back(us);
+                    iterations.push_back(solver.get_iterations());
+                } else {
+                    first_us+=us;
+                }
+                successes+=(success(*problem,forces)?1:0);
+            }
+        }
+
+        auto prefix=string("tracking.")+(warm?"warm":"cold");
+        report(prefix+".iterations.mean",accumulate(begin(iterations),end(iterations),0.)/iterations.size(),
+               "iterations/tick");
+        report(prefix+".iterations.p50",percentile(iterations,.5),"iterations/tick");
+        report(prefix+".iterations.p99",percentile(iterations,.99),"iterations/tick");
+        report(prefix+".first_tick",first_us/problems.size(),"us");
+        report(prefix+".p50",percentile(samples,.5),"us/tick");
+        report(prefix+".p99",percentile(samples,.99),"us/tick");
+        report(prefix+".max",*max_element(begin(samples),end(samples)),"us/tick");
+        report(prefix+".successes",successes,"ticks");
+    }
+}
+
+/***************************************************/
+void bench_async(const int num_problems)
+{
+    // each request gets superseded shortly after submission, as it
+    // happens when a newer load overtakes a stale one
+    auto problems=make_corpus("patch",num_problems);
+    AsyncSolver solver;
+    vector<double> samples;
+    int cancelled=0;
+    for (auto &problem:problems) {
+        CancelToken token;
+        auto result=solver.solve_async(*problem,token);
+        this_thread::sleep_for(chrono::microseconds(200));
+        samples.push_back(measure_us(1,[&]() { token.cancel(); result.wait(); }));
+        cancelled+=(result.get().cancelled?1:0);
+    }
+
+    report("async.cancel.p50",percentile(samples,.5),"us");
+    report("async.cancel.p99",percentile(samples,.99),"us");
+    report("async.cancel.max",*max_element(begin(samples),end(samples)),"us");
+    report("async.cancelled",cancelled,"problems");
+}
+
+/***************************************************/
+void bench_hessian(const int num_problems)
+{
+    for (auto &type:{"circle","patch"}) {
+        auto problems=make_corpus(type,num_problems);
+        for (auto hessian:{HessianMode::exact,HessianMode::limited_memory}) {
+            auto app=Solver::make_application(false,hessian);
+            double iterations=0., t=0., geometry_evals=0.;
+            int successes=0;
+            for (auto &problem:problems) {
+                Ipopt::SmartPtr<Grasp> nlp=new Grasp(*problem,2,hessian);
+                t+=measure_us(1,[&]() { app->OptimizeTNLP(Ipopt::GetRawPtr(nlp)); });
+                iterations+=nlp->get_iterations();
+                geometry_evals+=nlp->get_stats().geometry_evals;
+
+                successes+=(success(*problem,nlp->get_result())?1:0);
+            }
+            auto prefix=string("hessian.")+type+(hessian==HessianMode::exact?".exact":".lbfgs");
+            report(prefix+".iterations",iterations/num_problems,"iterations");
+            report(prefix+".time",t/num_problems,"us");
+            report(prefix+".geometry_evals",geometry_evals/std::max(iterations,1.),"contacts/iteration");
+            report(prefix+".successes",successes,"problems");
+        }
+    }
+}
+
+/***************************************************/
+void bench_parametrization(const int num_problems)
+{
+    for (auto &type:{"circle","patch"}) {
+        auto problems=make_corpus(type,num_problems);
+        auto app=Solver::make_application(false,HessianMode::exact);
+        for (auto parametrization:{Parametrization::angle,Parametrization::arc_length}) {
+            double iterations=0., t=0.;
+            int successes=0;
+            for (auto &problem:problems) {
+                Ipopt::SmartPtr<Grasp> nlp=new Grasp(*problem,2,HessianMode::exact,parametrization);
+                t+=measure_us(1,[&]() { app->OptimizeTNLP(Ipopt::GetRawPtr(nlp)); });
+                iterations+=nlp->get_iterations();
+                successes+=(success(*problem,nlp->get_result())?1:0);
+            }
+            auto prefix=string("parametrization.")+type+
+                        (parametrization==Parametrization::angle?".angle":".arc_length");
+            report(prefix+".iterations",iterations/num_problems,"iterations");
+            report(prefix+".time",t/num_problems,"us");
+            report(prefix+".successes",successes,"problems");
+        }
+    }
+}
+
+/***************************************************/
+void bench_reuse(const int num_problems)
+{
+    auto problems=make_corpus("patch",num_problems);
+
+    double t_oneshot=0.;
+    for (auto &problem:problems) {
+        t_oneshot+=measure_us(1,[&]() { Solver::solve(*problem,false); });
+    }
+
+    Solver solver;
+    double t_reuse=0.;
+    for (auto &problem:problems) {
+        t_reuse+=measure_us(1,[&]() { solver.compute(*problem); });
+    }
+
+    t_oneshot/=num_problems;
+    t_reuse/=num_problems;
+    report("reuse.oneshot",t_oneshot,"us");
+    report("reuse.reused",t_reuse,"us");
+}
+
+/***************************************************/
+void bench_batch(const int num_problems)
+{
+    auto problems=make_corpus("patch",num_problems);
+
+    double t_single=0.;
+    // powers of two, plus the core count if it is not one of them
+    auto max_workers=std::max(1U,thread::hardware_concurrency());
+    vector<unsigned int> workers;
+    for (unsigned int num_workers=1; num_workers<max_workers; num_workers<<=1) {
+        workers.push_back(num_workers);
+    }
+    workers.push_back(max_workers);
+    for (auto num_workers:workers) {
+        BatchSolver solver(num_workers);
+        auto t=measure_us(1,[&]() { solver.solve_batch(begin(problems),end(problems)); });
+        if (num_workers==1) {
+            t_single=t;
+        }
+        auto prefix="batch.workers_"+to_string(num_workers);
+        report(prefix+".throughput",num_problems/(t*1e-6),"problems/s");
+        report(prefix+".speedup",t_single/t,"x");
+    }
+}
+
+/***************************************************/
+void bench_multistart(const int num_problems)
+{
+    auto problems=make_corpus("patch",num_problems);
+
+    Solver single;
+    BatchSolver multi;
+    double t_single=0., t_multi=0.;
+    int successes_single=0, successes_multi=0;
+    for (auto &problem:problems) {
+        vector<Force> forces;
+        t_single+=measure_us(1,[&]() { forces=single.compute(*problem); });
+        successes_single+=(success(*problem,forces)?1:0);
+        t_multi+=measure_us(1,[&]() { forces=multi.solve_multistart(*problem); });
+        successes_multi+=(success(*problem,forces)?1:0);
+    }
+    report("multistart.single.time",t_single/num_problems,"us");
+    report("multistart.single.successes",successes_single,"problems");
+    report("multistart.multi.time",t_multi/num_problems,"us");
+    report("multistart.multi.successes",successes_multi,"problems");
+}
+
+/***************************************************/
+void bench_graspmap(const int num_problems)
+{
+    auto problems=make_corpus("patch",num_problems);
+
+    // the time of the seeded solver includes building the map
+    for (auto resolution:{0,12,36}) {
+        Solver solver;
+        solver.set_map_seeding(resolution);
+        double iterations=0., t=0.;
+        int successes=0;
+        for (auto &problem:problems) {
+            vector<Force> forces;
+            t+=measure_us(1,[&]() { forces=solver.compute(*problem); });
+            iterations+=solver.get_iterations();
+            successes+=(success(*problem,forces)?1:0);
+        }
+        auto prefix=(resolution==0?string("graspmap.default_seed"):
+                                   "graspmap.map_seed_"+to_string(resolution));
+        report(prefix+".iterations",iterations/num_problems,"iterations");
+        report(prefix+".time",t/num_problems,"us");
+        report(prefix+".successes",successes,"problems");
+    }
+}
+
+/***************************************************/
+void bench_contact(const int num_problems)
+{
+    for (auto &type:{"circle","patch"}) {
+        auto problems=make_corpus(type,num_problems);
+        Solver ipopt;
+        ContactSolver contact;
+        auto run=[&](const string &name, const function<vector<Force>(const Problem&)> &solve) {
+            double t=0., F_max=0., T_max=0., effort=0.;
+            int successes=0;
+            for (auto &problem:problems) {
+                vector<Force> forces;
+                t+=measure_us(1,[&]() { forces=solve(*problem); });
+                for (auto &f:forces) {
+                    effort+=f.fn*f.fn+f.ft*f.ft;
+                }
+                auto F_T=problem->compute_newton_law(forces);
+                auto F=hypot(F_T.first[0],F_T.first[1]);
+                auto T=fabs(F_T.second);
+                F_max=std::max(F_max,F);
+                T_max=std::max(T_max,T);
+                if ((F<.01) && (T<.01) && problem->check_no_slippage(forces)) {
+                    successes++;
+                }
+            }
+            auto prefix=name+"."+type;
+            report(prefix+".time",t/num_problems,"us");
+            report(prefix+".successes",successes,"problems");
+            report(prefix+".max_F",F_max,"abs");
+            report(prefix+".max_T",T_max,"abs");
+            report(prefix+".effort",effort/num_problems,"abs");
+        };
+        run("contact.ipopt",[&](const Problem& problem) { return ipopt.compute(problem); });
+        run("contact.fixed_contacts",[&](const Problem& problem) { return contact.solve(problem); });
+    }
+}
+
+}
+
+/***************************************************/
+int main(int argc, char* argv[])
+{
+    ResourceFinder rf;
+    rf.configure(argc,argv);
+    auto num_problems=rf.check("problems")?rf.find("problems").asInt32():100;
+    auto repetitions=rf.check("repetitions")?rf.find("repetitions").asInt32():100;
+    seed=rf.check("seed")?(unsigned int)rf.find("seed").asInt32():1U;
+    auto format=rf.check("format")?rf.find("format").asString():string("text");
+    if ((format!="text") && (format!="json")) {
+        cerr << "Unrecognized format \"" << format << "\"" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // micro-benchmarks of the hot paths
+    bench_geometry(num_problems,repetitions);
+    bench_configure(num_problems,repetitions);
+    bench_newton_law(num_problems,repetitions);
+    bench_arc_length(num_problems,repetitions);
+    bench_autodiff(num_problems,repetitions);
+    bench_generate(num_problems,repetitions);
+
+    // solvers
+    bench_latency(num_problems);
+    bench_deadline(num_problems);
+    bench_tracking(num_problems);
+    bench_async(num_problems);
+    bench_hessian(num_problems);
+    bench_parametrization(num_problems);
+    bench_reuse(num_problems);
+    bench_batch(num_problems);
+    bench_multistart(num_problems);
+    bench_graspmap(num_problems);
+    bench_contact(num_problems);
+
+    ofstream fout;
+    if (rf.check("output")) {
+        fout.open(rf.find("output").asString());
+        if (!fout.is_open()) {
+            cerr << "Unable to open \"" << rf.find("output").asString() << "\"" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    auto &out=(fout.is_open()?static_cast<ostream&>(fout):cout);
+    if (format=="json") {
+        print_json(out);
+    } else {
+        print_text(out);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cmath>
+#include <algorithm>
+#include "arclength.h"
+
+using namespace std;
+using namespace problem_ns;
+
+namespace {
+
+// bounds of the automatic resolution, and cells per sharpest feature
+// keeping |ds/dt-|dP||/|dP| within ~1e-6
+constexpr size_t min_resolution=512;
+constexpr size_t max_resolution=1<<18;
+constexpr double cells_per_feature=6.;
+
+/***************************************************/
+template<size_t N>
+Dual<N> revert(const Dual<N>& s)
+{
+    // given s(t0+dt)-s(t0)=sum_k a_k*dt^k, with a_k=s.c[k], the
+    // series is reverted by fixed-point iterations, each of which
+    // gets one more coefficient of dt(ds) right
+    Dual<N> dt(0.);
+    if (N>0) {
+        auto ia=1./s.c[1];
+        auto sigma=Dual<N>::variable(0.);
+        dt=sigma*ia;
+        for (size_t iter=1; iter<N; iter++) {
+            Dual<N> p(s.c[N]);
+            for (size_t k=N; k>2; k--) {
+                p=p*dt;
+                p+=s.c[k-1];
+            }
+            dt=(sigma-sqr(dt)*p)*ia;
+        }
+    }
+    return dt;
+}
+
+}
+
+/***************************************************/
+size_t ArcLength::calc_resolution(const Problem& problem)
+{
+    // at the center of a lobe of amplitude c and width w, r' vanishes
+    // while r''=-2c/w^2, hence the speed sqrt(r^2+r'^2) turns sharply
+    // over a span of ~r/|r''|=w^2*(1+c)/(2|c|), which may be much
+    // narrower than the lobe itself
+    if (problem.is_circle()) {
+        return min_resolution;
+    }
+    const auto &shape=problem.get_shape();
+    const auto &widths=problem.get_widths();
+    auto feature=2.*M_PI;
+    for (size_t k=0; k<shape.size(); k++) {
+        auto c=shape[k];
+        if (c!=0.) {
+            auto w=widths[k];
+            feature=std::min(feature,std::min(w,w*w*fabs(1.+c)/(2.*fabs(c))));
+        }
+    }
+
+    auto M=ceil(2.*M_PI*cells_per_feature/feature);
+    if (!(M<=max_resolution)) {
+        return 0;
+    }
+    return std::max((size_t)M,min_resolution);
+}
+
+/***************************************************/
+ArcLength::ArcLength(const Problem& problem, const size_t resolution)
+{
+    // the automatic resolution caps the size of the table, even if
+    // it falls short of the accuracy then
+    auto M=resolution;
+    if (M==0) {
+        M=calc_resolution(problem);
+        if (M==0) {
+            M=max_resolution;
+        }
+    }
+    h=2.*M_PI/M;
+    s.assign(M+1,0.);
+    a.assign(7*M,0.);
+    index.assign(M,0);
+
+    // speed as Taylor polynomial of order 2 at the nodes
+    vector<Dual<2>> v(M+1);
+    for (size_t i=0; i<M; i++) {
+        auto frame=problem.eval_frame(i*h);
+        Dual<2> Tx, Ty;
+        Tx.c[0]=frame.dP.x; Tx.c[1]=frame.d2P.x; Tx.c[2]=.5*frame.d3P.x;
+        Ty.c[0]=frame.dP.y; Ty.c[1]=frame.d2P.y; Ty.c[2]=.5*frame.d3P.y;
+        v[i]=sqrt(sqr(Tx)+sqr(Ty));
+    }
+    v[M]=v[0];
+
+    for (size_t i=0; i<M; i++) {
+        // quintic Hermite v0+d0*x+e0/2*x^2+c3*x^3+c4*x^4+c5*x^5 matching
+        // the value and the first two derivatives at both ends of the cell
+        auto v0=v[i].c[0], d0=v[i].c[1], e0=2.*v[i].c[2];
+        auto A=v[i+1].c[0]-(v0+h*(d0+.5*h*e0));
+        auto B=v[i+1].c[1]-(d0+h*e0);
+        auto C=2.*v[i+1].c[2]-e0;
+        auto h2=h*h, h3=h2*h;
+        auto c3=(10.*A-4.*B*h+.5*C*h2)/h3;
+        auto c4=(-15.*A+7.*B*h-C*h2)/(h3*h);
+        auto c5=(6.*A-3.*B*h+.5*C*h2)/(h3*h2);
+
+        // and its integral
+        auto *ai=&a[7*i];
+        ai[0]=s[i];
+        ai[1]=v0;
+        ai[2]=d0/2.;
+        ai[3]=e0/6.;
+        ai[4]=c3/4.;
+        ai[5]=c4/5.;
+        ai[6]=c5/6.;
+        s[i+1]=calc_length<0>(i,h).value();
+    }
+
+    // s(t) is monotonic, hence the cells of a uniform grid in s
+    // can be found walking forward
+    auto L=s[M];
+    for (size_t j=0, i=0; j<M; j++) {
+        auto sj=(j*L)/M;
+        while ((i+1<M) && (s[i+1]<=sj)) {
+            i++;
+        }
+        index[j]=i;
+    }
+}
+
+/***************************************************/
+size_t ArcLength::get_cell(const double t) const
+{
+    return std::min((size_t)(t/h),index.size()-1);
+}
+
+/***************************************************/
+template<size_t N>
+Dual<N> ArcLength::calc_length(const size_t i, const double tau) const
+{
+    // Taylor coefficients of the polynomial of cell i at tau,
+    // through repeated synthetic division by (x-tau)
+    double b[7];
+    copy(&a[7*i],&a[7*i]+7,b);
+    Dual<N> d;
+    for (size_t k=0; k<=N; k++) {
+        for (size_t j=6; j>k; j--) {
+            b[j-1]+=tau*b[j];
+        }
+        d.c[k]=b[k];
+    }
+    return d;
+}
+
+/***************************************************/
+size_t ArcLength::get_resolution() const
+{
+    return index.size();
+}
+
+/***************************************************/
+double ArcLength::get_length() const
+{
+    return s.back();
+}
+
+/***************************************************/
+double ArcLength::eval_length(const double t) const
+{
+    auto tw=Problem::wrap_angle(t);
+    auto i=get_cell(tw);
+    return calc_length<0>(i,tw-i*h).value();
+}
+
+/***************************************************/
+double ArcLength::eval_angle(const double s_) const
+{
+    auto M=index.size();
+    auto L=s[M];
+    auto sw=fmod(s_,L);
+    if (sw<0.) {
+        sw+=L;
+    }
+
+    // start from the inverse index and walk forward to the cell
+    auto i=index[std::min((size_t)(sw*M/L),M-1)];
+    while ((i+1<M) && (s[i+1]<=sw)) {
+        i++;
+    }
+
+    // Newton iterations within the cell, starting from the chord
+    auto tau=h*(sw-s[i])/(s[i+1]-s[i]);
+    for (int iter=0; iter<8; iter++) {
+        auto d=calc_length<1>(i,tau);
+        auto dtau=(d.c[0]-sw)/d.c[1];
+        tau=std::max(0.,std::min(tau-dtau,h));
+        if (fabs(dtau)<1e-14*h) {
+            break;
+        }
+    }
+    return Problem::wrap_angle(i*h+tau);
+}
+
+/***************************************************/
+template<size_t N>
+Dual<N> ArcLength::eval_angle_jet(const double s) const
+{
+    auto t0=eval_angle(s);
+    auto i=get_cell(t0);
+    auto dt=revert(calc_length<N>(i,t0-i*h));
+    dt.c[0]=t0;
+    return dt;
+}
+
+template Dual<0> ArcLength::eval_angle_jet<0>(const double) const;
+template Dual<1> ArcLength::eval_angle_jet<1>(const double) const;
+template Dual<2> ArcLength::eval_angle_jet<2>(const double) const;
+template Dual<3> ArcLength::eval_angle_jet<3>(const double) const;
+
+/***************************************************/
+template<size_t N>
+WrenchJet<N> ArcLength::eval_wrench_jet(const Problem& problem, const double s) const
+{
+    auto dt=eval_angle_jet<N>(s);
+    auto jet=problem.eval_wrench_jet<N>(dt.value());
+
+    // tangential[0..1] is T itself, which gets normalized
+    // before applying the chain rule through t(s)
+    auto ispeed=Dual<N>(1.)/sqrt(sqr(jet.tangential[0])+sqr(jet.tangential[1]));
+    for (size_t j=0; j<3; j++) {
+        jet.normal[j]=compose(jet.normal[j]*ispeed,dt);
+        jet.tangential[j]=compose(jet.tangential[j]*ispeed,dt);
+    }
+    return jet;
+}
+
+template WrenchJet<0> ArcLength::eval_wrench_jet<0>(const Problem&, const double) const;
+template WrenchJet<1> ArcLength::eval_wrench_jet<1>(const Problem&, const double) const;
+template WrenchJet<2> ArcLength::eval_wrench_jet<2>(const Problem&, const double) const;
+template WrenchJet<3> ArcLength::eval_wrench_jet<3>(const Problem&, const double) const;
@@ -0,0 +1,118 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef ARCLENGTH_H
+#define ARCLENGTH_H
+
+#include <cstddef>
+#include <vector>
+#include "problem.h"
+
+namespace problem_ns {
+
+/**
+ * Arc-length table of a Problem.
+ *
+ * The speed |dP| along with its first two derivatives is sampled at
+ * the nodes of a uniform grid in t and interpolated within each cell
+ * by a quintic Hermite polynomial, whose integral s(t) is stored as a
+ * polynomial of degree 6. Hence s(t) is C3 and lookups in either
+ * direction (t->s and s->t) involve no geometry at all: the inverse
+ * relies on an index over a uniform grid in s to find the cell, and
+ * on Newton iterations within it.
+ *
+ * Lookups are exact inverses of each other and the jets are the exact
+ * derivatives of the table's own t(s), whereas the table follows the
+ * true arc length only as well as the cells resolve the sharpest turn
+ * of the speed, which takes place at the center of narrow and deep
+ * lobes. The automatic resolution (see calc_resolution()) keeps
+ * |ds/dt-|dP||/|dP| within ~1e-6 with at most ~800 cells for 4 lobes
+ * of default width and ~2e5 for 64, at ~60 bytes per cell.
+ */
+class ArcLength
+{
+    double h{0.};
+    std::vector<double> s;
+    std::vector<double> a;
+    std::vector<size_t> index;
+
+    size_t get_cell(const double t) const;
+    template<size_t N>
+    Dual<N> calc_length(const size_t i, const double tau) const;
+
+public:
+   /**
+    * Build the table.
+    * @param problem is the configured problem.
+    * @param resolution is the number of cells; 0 selects it through
+    *        calc_resolution(), or picks the largest automatic table if
+    *        the accuracy cannot be met.
+    */
+    explicit ArcLength(const Problem& problem, const size_t resolution=0);
+
+   /**
+    * Work out the number of cells that keeps the table within ~1e-6
+    * of the true arc length, scaling with the number of lobes, their
+    * widths and their amplitudes; at least 512 cells are used.
+    * @param problem is the configured problem.
+    * @return the resolution, or 0 if the accuracy would take more
+    *         than 2^18 cells.
+    */
+    static size_t calc_resolution(const Problem& problem);
+
+   /**
+    * Retrieve the number of cells.
+    * @return the resolution.
+    */
+    size_t get_resolution() const;
+
+   /**
+    * Retrieve the length of the object's perimeter.
+    * @return the length.
+    */
+    double get_length() const;
+
+   /**
+    * Retrieve the arc length at a location of the perimeter.
+    * @param t is the parameter.
+    * @return the arc length s in [0,get_length()), measured from t=0.
+    */
+    double eval_length(const double t) const;
+
+   /**
+    * Retrieve the location of the perimeter at a given arc length,
+    * i.e. the inverse of eval_length().
+    * @param s is the arc length, which is wrapped around the perimeter.
+    * @return the parameter t in [0,2*PI).
+    */
+    double eval_angle(const double s) const;
+
+   /**
+    * Retrieve the location of the perimeter at a given arc length
+    * along with its derivatives wrt the arc length.
+    * @param s is the arc length.
+    * @return t(s) as Taylor polynomial of order N in s.
+    *
+    * @note Orders N<=3 are available.
+    */
+    template<size_t N>
+    Dual<N> eval_angle_jet(const double s) const;
+
+   /**
+    * Evaluate the wrench exerted at a contact located through its
+    * arc length, along with its derivatives wrt the arc length.
+    * @param problem is the problem the table was built for.
+    * @param s is the contact location as arc length.
+    * @return the wrench due to unit forces along the normalized N
+    *         and T, as Taylor polynomials of order N in s.
+    *
+    * @note Orders N<=3 are available.
+    */
+    template<size_t N>
+    WrenchJet<N> eval_wrench_jet(const Problem& problem, const double s) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,276 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cmath>
+#include <algorithm>
+#include "contact.h"
+
+using namespace std;
+using namespace problem_ns;
+
+namespace {
+
+/***************************************************/
+bool solve_linear(double A[3][3], double b[3], const size_t n)
+{
+    // Gaussian elimination with partial pivoting on a tiny system
+    for (size_t k=0; k<n; k++) {
+        auto p=k;
+        for (size_t i=k+1; i<n; i++) {
+            if (fabs(A[i][k])>fabs(A[p][k])) {
+                p=i;
+            }
+        }
+        if (fabs(A[p][k])<1e-12) {
+            return false;
+        }
+        swap(A[k],A[p]);
+        swap(b[k],b[p]);
+        for (size_t i=k+1; i<n; i++) {
+            auto f=A[i][k]/A[k][k];
+            for (size_t j=k; j<n; j++) {
+                A[i][j]-=f*A[k][j];
+            }
+            b[i]-=f*b[k];
+        }
+    }
+    for (size_t k=n; k-->0;) {
+        for (size_t j=k+1; j<n; j++) {
+            b[k]-=A[k][j]*b[j];
+        }
+        b[k]/=A[k][k];
+    }
+    return true;
+}
+
+/***************************************************/
+double solve_cone_nnls(const double B[4][3], const double w[3], double y[4])
+{
+    // min |B*y+w| s.t. y>=0, enumerating the active sets: with 3 rows,
+    // the optimum is attained with at most 3 columns (Caratheodory);
+    // ties on the residual are broken by the least sum(y)
+    auto best=sqrt(w[0]*w[0]+w[1]*w[1]+w[2]*w[2]);
+    auto best_effort=0.;
+    fill(y,y+4,0.);
+
+    for (unsigned int mask=1; mask<16; mask++) {
+        size_t idx[4], n=0;
+        for (size_t k=0; k<4; k++) {
+            if (mask&(1U<<k)) {
+                idx[n++]=k;
+            }
+        }
+        if (n>3) {
+            continue;
+        }
+
+        double A[3][3], b[3];
+        for (size_t i=0; i<n; i++) {
+            for (size_t j=0; j<n; j++) {
+                A[i][j]=B[idx[i]][0]*B[idx[j]][0]+B[idx[i]][1]*B[idx[j]][1]+B[idx[i]][2]*B[idx[j]][2];
+            }
+            b[i]=-(B[idx[i]][0]*w[0]+B[idx[i]][1]*w[1]+B[idx[i]][2]*w[2]);
+        }
+        if (!solve_linear(A,b,n) || any_of(b,b+n,[](const double v) { return (v<0.); })) {
+            continue;
+        }
+
+        double r[3]={w[0],w[1],w[2]}, effort=0.;
+        for (size_t i=0; i<n; i++) {
+            for (size_t k=0; k<3; k++) {
+                r[k]+=b[i]*B[idx[i]][k];
+            }
+            effort+=b[i];
+        }
+        auto res=sqrt(r[0]*r[0]+r[1]*r[1]+r[2]*r[2]);
+        if ((res<best-1e-12) || ((res<best+1e-12) && (effort<best_effort))) {
+            best=res;
+            best_effort=effort;
+            fill(y,y+4,0.);
+            for (size_t i=0; i<n; i++) {
+                y[idx[i]]=b[i];
+            }
+        }
+    }
+    return best;
+}
+
+/***************************************************/
+inline bool better(const ContactSolver::Solution& a, const ContactSolver::Solution& b)
+{
+    // smallest residual first, then smallest effort
+    auto effort=[](const ContactSolver::Solution& s) {
+        return (s.forces[0].fn*s.forces[0].fn+s.forces[0].ft*s.forces[0].ft+
+                s.forces[1].fn*s.forces[1].fn+s.forces[1].ft*s.forces[1].ft);
+    };
+    auto d=a.residual-b.residual;
+    return ((d<-1e-9) || ((d<1e-9) && (effort(a)<effort(b))));
+}
+
+}
+
+
+/***************************************************/
+ContactSolver::ContactSolver(const size_t resolution_, const int refinements_) :
+    resolution(resolution_), refinements(refinements_)
+{
+    assert(resolution>0);
+}
+
+/***************************************************/
+ContactSolver::Solution ContactSolver::solve_fixed(const Problem& problem, const Frame& frame1,
+                                                   const Frame& frame2, const Vec2& F0,
+                                                   const double T0)
+{
+    const auto &COM=problem.eval_COM();
+    auto friction=problem.get_friction();
+
+    // each contact force spans its friction cone through the edges N±friction*T
+    double B[4][3];
+    const Frame *frames[2]={&frame1,&frame2};
+    for (size_t i=0; i<2; i++) {
+        auto r=frames[i]->P-COM;
+        auto e0=frames[i]->N+friction*frames[i]->T;
+        auto e1=frames[i]->N-friction*frames[i]->T;
+        B[2*i][0]=e0.x; B[2*i][1]=e0.y; B[2*i][2]=cross(r,e0);
+        B[2*i+1][0]=e1.x; B[2*i+1][1]=e1.y; B[2*i+1][2]=cross(r,e1);
+    }
+
+    double w[3]={F0.x,F0.y,T0};
+    double y[4];
+    Solution sol;
+    sol.residual=solve_cone_nnls(B,w,y);
+    for (size_t i=0; i<2; i++) {
+        sol.forces[i].fn=y[2*i]+y[2*i+1];
+        sol.forces[i].ft=friction*(y[2*i]-y[2*i+1]);
+    }
+    return sol;
+}
+
+/***************************************************/
+ContactSolver::Solution ContactSolver::solve_fixed(const Problem& problem, const double t1,
+                                                   const double t2)
+{
+    const auto &w0=problem.get_F_wrench();
+    auto sol=solve_fixed(problem,problem.eval_frame(t1),problem.eval_frame(t2),w0.F,w0.T);
+    sol.forces[0].t=t1;
+    sol.forces[1].t=t2;
+    return sol;
+}
+
+/***************************************************/
+bool ContactSolver::solve_circle(const Problem& problem, vector<Force>& forces)
+{
+    if (!problem.is_circle()) {
+        return false;
+    }
+
+    // on the unit circle N and T are unit vectors, the COM is the origin
+    // and cross(P,T) is the same everywhere, thus the torques balance as
+    // soon as sum(ft)=-F.ft, while the effort sum(fn^2+ft^2) is the sum of
+    // the squared norms of the contact forces. These must add up to -F,
+    // hence the effort is at least |F|^2/2, which is attained by two equal
+    // forces -F/2 of norm m, as long as their angles b1, b2 wrt the normals
+    // at the contacts satisfy m*(sin(b1)+sin(b2))=-F.ft
+    const auto &F=problem.get_F();
+    auto m=hypot(F.fn,F.ft)/2.;
+    auto b0=atan2(-F.ft,fabs(F.fn));
+    auto c=atan(problem.get_friction());
+
+    // b1=b0=b2 makes the contacts coincide, thus they are spread apart
+    // as b1=b+d, b2=b-d, with sin(b)*cos(d)=sin(b0) to keep balancing
+    // the torque, until |b|+d reaches halfway to the friction cone; the
+    // contacts coincide only when there is no friction
+    auto spread=[&](const double d) { return asin(fabs(sin(b0))/cos(d))+d; };
+    auto target=(fabs(b0)+c)/2.;
+    double lo=0., hi=std::max(c-fabs(b0),0.);
+    for (int i=0; i<60; i++) {
+        auto d=(lo+hi)/2.;
+        if (spread(d)>target) {
+            hi=d;
+        } else {
+            lo=d;
+        }
+    }
+    auto d=lo;
+    auto b=copysign(asin(fabs(sin(b0))/cos(d)),b0);
+
+    // the frame rotates rigidly along the circle, thus each contact lies
+    // away from F by the angle between <fn,ft> expressed in the frame
+    // at F.t and the target force -F/2
+    auto frame=problem.eval_frame(F.t);
+    auto target_force=-.5*(F.fn*frame.N+F.ft*frame.T);
+    forces.resize(2);
+    for (size_t i=0; i<2; i++) {
+        auto bi=(i==0?b+d:b-d);
+        Force f{0.,m*cos(bi),m*sin(bi)};
+        if (!problem.check_no_slippage(f)) {
+            return false;
+        }
+        auto a=f.fn*frame.N+f.ft*frame.T;
+        f.t=Problem::wrap_angle(F.t+atan2(cross(a,target_force),dot(a,target_force)));
+        forces[i]=f;
+    }
+    return true;
+}
+
+/***************************************************/
+vector<Force> ContactSolver::solve(const Problem& problem) const
+{
+    vector<Force> forces;
+    if (solve_circle(problem,forces)) {
+        return forces;
+    }
+
+    const auto &w0=problem.get_F_wrench();
+
+    // coarse scan over the grid t1<t2
+    vector<Frame> frames(resolution);
+    for (size_t i=0; i<resolution; i++) {
+        frames[i]=problem.eval_frame((2.*M_PI*i)/resolution);
+    }
+
+    Solution best;
+    best.residual=HUGE_VAL;
+    double t1=0., t2=0.;
+    for (size_t i=0; i<resolution; i++) {
+        for (size_t j=i+1; j<resolution; j++) {
+            auto sol=solve_fixed(problem,frames[i],frames[j],w0.F,w0.T);
+            if (better(sol,best)) {
+                best=sol;
+                t1=(2.*M_PI*i)/resolution;
+                t2=(2.*M_PI*j)/resolution;
+            }
+        }
+    }
+
+    // pattern search around the best cell
+    auto step=M_PI/resolution;
+    const double dirs[4][2]={{1.,0.},{-1.,0.},{0.,1.},{0.,-1.}};
+    for (int halvings=0; halvings<refinements;) {
+        auto improved=false;
+        for (auto &d:dirs) {
+            auto t1_=t1+d[0]*step;
+            auto t2_=t2+d[1]*step;
+            auto sol=solve_fixed(problem,problem.eval_frame(t1_),problem.eval_frame(t2_),w0.F,w0.T);
+            if (better(sol,best)) {
+                best=sol;
+                t1=t1_;
+                t2=t2_;
+                improved=true;
+            }
+        }
+        if (!improved) {
+            step/=2.;
+            halvings++;
+        }
+    }
+
+    best.forces[0].t=Problem::wrap_angle(t1);
+    best.forces[1].t=Problem::wrap_angle(t2);
+    return vector<Force>{best.forces[0],best.forces[1]};
+}
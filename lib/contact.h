@@ -0,0 +1,103 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef CONTACT_H
+#define CONTACT_H
+
+#include <cstddef>
+#include <vector>
+#include "problem.h"
+
+namespace problem_ns {
+
+/**
+ * Ipopt-free solver built on the fixed-contacts sub-problem.
+ *
+ * Once t1 and t2 are fixed, Newton's law is linear in <fn1,ft1,fn2,ft2>
+ * and the friction cones are linear inequalities. Writing each force as
+ * a nonnegative combination y of its cone edges N±friction*T yields
+ * min |B*y+w| s.t. y>=0, with B 3x4. Its optimum has at most 3 active
+ * columns, hence enumerating the active sets solves it exactly without
+ * allocations: when a zero residual is attainable, the enumeration also
+ * returns the vertex of the LP {B*y=-w, y>=0} with least sum(fn).
+ *
+ * The outer search scans a grid over (t1,t2) and then refines the best
+ * cell with a pattern search.
+ *
+ * The search ranks the cells by residual first, hence it aims at
+ * balancing the load rather than at the least effort of the Grasp NLP:
+ * it complements Solver (seeds, fallbacks, machines without Ipopt) and
+ * does not replace it; the "contact" benchmark of bench_2Dgrasp
+ * compares the two.
+ */
+class ContactSolver
+{
+    size_t resolution;
+    int refinements;
+
+public:
+    /**
+     * Solution of the fixed-contacts sub-problem.
+     */
+    struct Solution {
+        double residual{0.};
+        Force forces[2];
+    };
+
+   /**
+    * Constructor.
+    * @param resolution is the number of grid samples per contact angle.
+    * @param refinements is the number of step halvings of the pattern search.
+    */
+    explicit ContactSolver(const size_t resolution=36, const int refinements=20);
+
+   /**
+    * Solve the sub-problem with fixed contact locations.
+    * @param problem is the configured problem.
+    * @param frame1 is the surface frame at the first contact.
+    * @param frame2 is the surface frame at the second contact.
+    * @param F0 is the force due to F.
+    * @param T0 is the torque due to F.
+    * @return the solution, with the residual norm of Newton's law
+    *         (force and torque stacked).
+    */
+    static Solution solve_fixed(const Problem& problem, const Frame& frame1,
+                                const Frame& frame2, const Vec2& F0, const double T0);
+
+   /**
+    * Solve the sub-problem with fixed contact locations.
+    * @param problem is the configured problem.
+    * @param t1 is the first contact angle.
+    * @param t2 is the second contact angle.
+    * @return the solution.
+    */
+    static Solution solve_fixed(const Problem& problem, const double t1, const double t2);
+
+   /**
+    * Solve the problem in closed form when the object is a circle.
+    *
+    * The two contacts apply -F/2 each, which attains the least effort
+    * sum(fn^2+ft^2)=|F|^2/2 of the Grasp NLP. Such optima form a
+    * continuum: the one returned keeps the contacts apart, with the
+    * forces halfway between F's inclination and the friction cone
+    * edges. With no friction, the only optimum has the two contacts
+    * at the same location.
+    * @param problem to solve.
+    * @param forces is the vector filled with the applied forces.
+    * @return true if the object is a circle and the closed-form
+    *         forces lie within the friction cones, i.e. if F does.
+    */
+    static bool solve_circle(const Problem& problem, std::vector<Force>& forces);
+
+   /**
+    * Solve the problem searching over the contact angles.
+    * @param problem to solve.
+    * @return a vector containing the applied forces.
+    */
+    std::vector<Force> solve(const Problem& problem) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,438 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <chrono>
+#include <algorithm>
+#include "corpus.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace problem_ns;
+
+namespace {
+
+// problem records gained the lobe widths in version 2
+constexpr uint32_t problem_format_version=2;
+constexpr uint32_t result_format_version=1;
+constexpr uint32_t endianness=0x01020304;
+constexpr size_t alignment=64;
+
+/***************************************************/
+struct ProblemHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianness;
+    uint64_t count;
+    uint32_t num_lobes;
+    uint32_t record_size;
+    uint8_t reserved[32];
+};
+
+/***************************************************/
+struct ResultHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianness;
+    uint64_t count;
+    uint32_t num_contacts;
+    uint32_t num_columns;
+    uint8_t reserved[32];
+};
+
+/***************************************************/
+struct ColumnEntry {
+    char name[24];
+    uint32_t type;
+    uint32_t padding;
+    uint64_t offset;
+};
+
+static_assert(sizeof(ProblemHeader)==64,"unexpected size of ProblemHeader");
+static_assert(sizeof(ResultHeader)==64,"unexpected size of ResultHeader");
+static_assert(sizeof(ColumnEntry)==40,"unexpected size of ColumnEntry");
+
+const char problem_magic[8]={'2','D','G','R','A','S','P','P'};
+const char result_magic[8]={'2','D','G','R','A','S','P','R'};
+
+/***************************************************/
+inline size_t align(const size_t offset)
+{
+    return ((offset+alignment-1)/alignment)*alignment;
+}
+
+/***************************************************/
+inline size_t problem_record_size(const size_t num_lobes)
+{
+    return sizeof(double)*(2*num_lobes+6);
+}
+
+}
+
+/***************************************************/
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+/***************************************************/
+bool MappedFile::open(const string &path, const bool writable)
+{
+    close();
+
+    // handles can be released as soon as the view is mapped
+#ifdef _WIN32
+    auto file=CreateFileA(path.c_str(),GENERIC_READ|(writable?GENERIC_WRITE:0),
+                          FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+    if (file==INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file,&file_size) || (file_size.QuadPart==0)) {
+        CloseHandle(file);
+        return false;
+    }
+    auto mapping=CreateFileMappingA(file,nullptr,writable?PAGE_READWRITE:PAGE_READONLY,0,0,nullptr);
+    CloseHandle(file);
+    if (mapping==nullptr) {
+        return false;
+    }
+    auto view=MapViewOfFile(mapping,writable?FILE_MAP_WRITE:FILE_MAP_READ,0,0,0);
+    CloseHandle(mapping);
+    if (view==nullptr) {
+        return false;
+    }
+    data=static_cast<unsigned char*>(view);
+    length=(size_t)file_size.QuadPart;
+#else
+    auto fd=::open(path.c_str(),writable?O_RDWR:O_RDONLY);
+    if (fd<0) {
+        return false;
+    }
+    struct stat st;
+    if ((fstat(fd,&st)!=0) || (st.st_size==0)) {
+        ::close(fd);
+        return false;
+    }
+    auto view=mmap(nullptr,(size_t)st.st_size,PROT_READ|(writable?PROT_WRITE:0),
+                   MAP_SHARED,fd,0);
+    ::close(fd);
+    if (view==MAP_FAILED) {
+        return false;
+    }
+    if (!writable) {
+        madvise(view,(size_t)st.st_size,MADV_SEQUENTIAL);
+    }
+    data=static_cast<unsigned char*>(view);
+    length=(size_t)st.st_size;
+#endif
+    return true;
+}
+
+/***************************************************/
+void MappedFile::close()
+{
+    if (data!=nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(data,length);
+#endif
+        data=nullptr;
+        length=0;
+    }
+}
+
+/***************************************************/
+unsigned char* MappedFile::get_data() const
+{
+    return data;
+}
+
+/***************************************************/
+size_t MappedFile::size() const
+{
+    return length;
+}
+
+/***************************************************/
+CorpusWriter::~CorpusWriter()
+{
+    close();
+}
+
+/***************************************************/
+bool CorpusWriter::open(const string &path, const size_t num_lobes)
+{
+    close();
+    this->num_lobes=num_lobes;
+    count=0;
+
+    fout.open(path,ios::binary|ios::trunc);
+    if (!fout.is_open()) {
+        return false;
+    }
+
+    // the count is updated upon closing
+    ProblemHeader header{};
+    memcpy(header.magic,problem_magic,sizeof(header.magic));
+    header.version=problem_format_version;
+    header.endianness=endianness;
+    header.num_lobes=(uint32_t)num_lobes;
+    header.record_size=(uint32_t)problem_record_size(num_lobes);
+    fout.write(reinterpret_cast<const char*>(&header),sizeof(header));
+    return fout.good();
+}
+
+/***************************************************/
+bool CorpusWriter::write(const Problem &problem)
+{
+    const auto &shape=problem.get_shape();
+    if (!fout.is_open() || (shape.size()!=num_lobes)) {
+        return false;
+    }
+
+    vector<double> record(shape);
+    const auto &widths=problem.get_widths();
+    record.insert(end(record),begin(widths),end(widths));
+    const auto &F=problem.get_F();
+    const auto &COM=problem.eval_COM();
+    record.insert(end(record),{problem.get_friction(),F.t,F.fn,F.ft,COM.x,COM.y});
+    fout.write(reinterpret_cast<const char*>(record.data()),sizeof(double)*record.size());
+    count++;
+    return fout.good();
+}
+
+/***************************************************/
+void CorpusWriter::close()
+{
+    if (fout.is_open()) {
+        fout.seekp(offsetof(ProblemHeader,count));
+        fout.write(reinterpret_cast<const char*>(&count),sizeof(count));
+        fout.close();
+    }
+}
+
+/***************************************************/
+bool CorpusReader::open(const string &path)
+{
+    count=0;
+    if (!file.open(path) || (file.size()<sizeof(ProblemHeader))) {
+        return false;
+    }
+
+    // the number of records is checked against the file size by division,
+    // as the product could overflow
+    ProblemHeader header;
+    memcpy(&header,file.get_data(),sizeof(header));
+    if ((memcmp(header.magic,problem_magic,sizeof(header.magic))!=0) ||
+        (header.version!=problem_format_version) || (header.endianness!=endianness) ||
+        (header.num_lobes==0) || (header.record_size!=problem_record_size(header.num_lobes)) ||
+        (header.count>(file.size()-sizeof(header))/header.record_size)) {
+        file.close();
+        return false;
+    }
+
+    num_lobes=header.num_lobes;
+    record_size=header.record_size;
+    count=header.count;
+    return true;
+}
+
+/***************************************************/
+size_t CorpusReader::size() const
+{
+    return (size_t)count;
+}
+
+/***************************************************/
+size_t CorpusReader::get_num_lobes() const
+{
+    return num_lobes;
+}
+
+/***************************************************/
+bool CorpusReader::read(const size_t i, Problem &problem) const
+{
+    assert(i<count);
+
+    // records are 8-byte aligned within the page-aligned mapping
+    auto record=reinterpret_cast<const double*>(file.get_data()+sizeof(ProblemHeader)+i*record_size);
+    vector<double> shape(record,record+num_lobes);
+    vector<double> widths(record+num_lobes,record+2*num_lobes);
+    auto rest=record+2*num_lobes;
+    Force F;
+    F.t=rest[1];
+    F.fn=rest[2];
+    F.ft=rest[3];
+
+    // the cached COM spares the quadrature
+    return problem.configure(shape,widths,Vec2(rest[4],rest[5]),rest[0],F);
+}
+
+/***************************************************/
+Vec2 CorpusReader::read_COM(const size_t i) const
+{
+    assert(i<count);
+    auto record=reinterpret_cast<const double*>(file.get_data()+sizeof(ProblemHeader)+i*record_size);
+    return Vec2(record[2*num_lobes+4],record[2*num_lobes+5]);
+}
+
+/***************************************************/
+bool ResultWriter::open(const string &path, const size_t count,
+                        const size_t num_contacts)
+{
+    file.close();
+    f64.clear();
+    i32.clear();
+    this->count=count;
+    this->num_contacts=num_contacts;
+
+    // directory: 3 columns per contact, then the wrench and the stats
+    vector<ColumnEntry> columns;
+    auto add=[&](const string &name, const uint32_t type) {
+        ColumnEntry entry{};
+        strncpy(entry.name,name.c_str(),sizeof(entry.name)-1);
+        entry.type=type;
+        columns.push_back(entry);
+    };
+    for (size_t k=1; k<=num_contacts; k++) {
+        add("t"+to_string(k),0);
+        add("fn"+to_string(k),0);
+        add("ft"+to_string(k),0);
+    }
+    for (auto &name:{"Fx","Fy","T","time_us"}) {
+        add(name,0);
+    }
+    for (auto &name:{"status","iterations"}) {
+        add(name,1);
+    }
+
+    auto offset=align(sizeof(ResultHeader)+columns.size()*sizeof(ColumnEntry));
+    for (auto &c:columns) {
+        c.offset=offset;
+        offset=align(offset+count*(c.type==0?sizeof(double):sizeof(int32_t)));
+    }
+
+    ResultHeader header{};
+    memcpy(header.magic,result_magic,sizeof(header.magic));
+    header.version=result_format_version;
+    header.endianness=endianness;
+    header.count=count;
+    header.num_contacts=(uint32_t)num_contacts;
+    header.num_columns=(uint32_t)columns.size();
+
+    // size the file up front, then map it to fill the columns in place
+    {
+        ofstream fout(path,ios::binary|ios::trunc);
+        if (!fout.is_open()) {
+            return false;
+        }
+        fout.write(reinterpret_cast<const char*>(&header),sizeof(header));
+        fout.write(reinterpret_cast<const char*>(columns.data()),columns.size()*sizeof(ColumnEntry));
+        fout.seekp(offset-1);
+        fout.put(0);
+        if (!fout.good()) {
+            return false;
+        }
+    }
+    if (!file.open(path,true)) {
+        return false;
+    }
+
+    for (auto &c:columns) {
+        if (c.type==0) {
+            f64.push_back(reinterpret_cast<double*>(file.get_data()+c.offset));
+        } else {
+            i32.push_back(reinterpret_cast<int32_t*>(file.get_data()+c.offset));
+        }
+    }
+    return true;
+}
+
+/***************************************************/
+size_t ResultWriter::size() const
+{
+    return (size_t)count;
+}
+
+/***************************************************/
+size_t ResultWriter::get_num_contacts() const
+{
+    return num_contacts;
+}
+
+/***************************************************/
+void ResultWriter::write(const size_t i, const SolveResult &result)
+{
+    assert((i<count) && (f64.size()==3*num_contacts+4));
+
+    // missing forces are marked as NaN
+    auto nan=numeric_limits<double>::quiet_NaN();
+    for (size_t k=0; k<num_contacts; k++) {
+        auto valid=(k<result.forces.size());
+        f64[3*k][i]=(valid?result.forces[k].t:nan);
+        f64[3*k+1][i]=(valid?result.forces[k].fn:nan);
+        f64[3*k+2][i]=(valid?result.forces[k].ft:nan);
+    }
+    auto j=3*num_contacts;
+    f64[j][i]=result.F.x;
+    f64[j+1][i]=result.F.y;
+    f64[j+2][i]=result.T;
+    f64[j+3][i]=result.time_us;
+    i32[0][i]=result.status;
+    i32[1][i]=result.iterations;
+}
+
+/***************************************************/
+bool problem_ns::solve_corpus(const CorpusReader &corpus, BatchSolver &solver,
+                              ResultWriter &results, const size_t chunk)
+{
+    if ((results.size()!=corpus.size()) ||
+        (results.get_num_contacts()!=solver.get_num_contacts()) || (chunk==0)) {
+        return false;
+    }
+
+    // only one chunk of problems is configured at a time
+    vector<Problem> problems(std::min(chunk,corpus.size()));
+    for (size_t first=0; first<corpus.size(); first+=chunk) {
+        auto n=std::min(chunk,corpus.size()-first);
+        solver.parallel_for(n,[&](Solver &s, const size_t i) {
+            auto &problem=problems[i];
+            SolveResult result;
+            if (corpus.read(first+i,problem)) {
+                auto t0=chrono::steady_clock::now();
+                result.forces=s.compute(problem);
+                auto t1=chrono::steady_clock::now();
+                result.time_us=chrono::duration<double,micro>(t1-t0).count();
+                result.status=(int32_t)s.get_status();
+                result.iterations=s.get_iterations();
+
+                Wrench wrench;
+                problem.eval_wrench(result.forces.data(),result.forces.size(),wrench,false);
+                result.F=wrench.F;
+                result.T=wrench.T;
+            } else {
+                // records that cannot be configured
+                result.status=-1;
+            }
+            results.write(first+i,result);
+        });
+    }
+    return true;
+}
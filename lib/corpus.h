@@ -0,0 +1,236 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "problem.h"
+#include "solver.h"
+
+namespace problem_ns {
+
+/**
+ * Binary corpora of problems and results.
+ *
+ * Both files start with a 64-byte header: an 8-char magic ("2DGRASPP"
+ * for problems, "2DGRASPR" for results), the uint32 format version, the
+ * uint32 endianness marker 0x01020304 and the uint64 number of records.
+ * Data are stored in native byte order.
+ *
+ * Problem files (version 2) continue with uint32 number of lobes K, uint32
+ * record size and then fixed-size records of doubles:
+ * shape[K], widths[K], friction, F<t,fn,ft>, COM<x,y>.
+ *
+ * Result files (version 1) are columnar: after the header (uint32 number of contacts,
+ * uint32 number of columns), a directory lists each column as 24-char name,
+ * uint32 type (0: float64, 1: int32), uint32 padding and uint64 byte offset.
+ * Columns are 64-byte aligned arrays with one entry per record: t<k>, fn<k>,
+ * ft<k> for each contact k, Fx, Fy, T, time_us, status and iterations.
+ * Hence, analysis tools can map the columns in place (e.g. numpy.memmap).
+ * Records that could not be configured report status -1.
+ */
+
+/**
+ * Memory-mapped file.
+ */
+class MappedFile
+{
+    unsigned char *data{nullptr};
+    size_t length{0};
+
+public:
+    MappedFile() = default;
+
+   /**
+    * Destructor, unmapping the file.
+    */
+    ~MappedFile();
+
+   /**
+    * Map a file.
+    * @param path is the file path.
+    * @param writable to map read-write an existing file.
+    * @return true/false on success/failure.
+    */
+    bool open(const std::string &path, const bool writable=false);
+
+   /**
+    * Unmap the file.
+    */
+    void close();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+   /**
+    * Retrieve the mapped bytes.
+    * @return the pointer to the first byte.
+    */
+    unsigned char* get_data() const;
+
+   /**
+    * Retrieve the length of the mapping.
+    * @return the number of bytes.
+    */
+    size_t size() const;
+};
+
+/**
+ * Sequential writer of problem corpora.
+ */
+class CorpusWriter
+{
+    std::ofstream fout;
+    size_t num_lobes;
+    uint64_t count{0};
+
+public:
+   /**
+    * Destructor, finalizing the file.
+    */
+    ~CorpusWriter();
+
+   /**
+    * Create the file.
+    * @param path is the file path.
+    * @param num_lobes is the number of lobes of all the problems.
+    * @return true/false on success/failure.
+    */
+    bool open(const std::string &path, const size_t num_lobes=4);
+
+   /**
+    * Append a problem.
+    * @param problem is the configured problem, with num_lobes lobes.
+    * @return true/false on success/failure.
+    */
+    bool write(const Problem &problem);
+
+   /**
+    * Finalize the file, storing the number of records.
+    */
+    void close();
+};
+
+/**
+ * Reader of problem corpora, memory-mapping the file so that
+ * records are paged in on demand.
+ */
+class CorpusReader
+{
+    MappedFile file;
+    size_t num_lobes{0};
+    size_t record_size{0};
+    uint64_t count{0};
+
+public:
+   /**
+    * Open and validate the file.
+    * @param path is the file path.
+    * @return true/false on success/failure.
+    */
+    bool open(const std::string &path);
+
+   /**
+    * Retrieve the number of problems.
+    * @return the number of records.
+    */
+    size_t size() const;
+
+   /**
+    * Retrieve the number of lobes of the problems.
+    * @return the number of lobes.
+    */
+    size_t get_num_lobes() const;
+
+   /**
+    * Configure a problem from a record, reusing the COM cached
+    * within it rather than integrating it again.
+    * @param i is the index of the record.
+    * @param problem is the caller-provided problem to configure.
+    * @return true/false on success/failure.
+    */
+    bool read(const size_t i, Problem &problem) const;
+
+   /**
+    * Retrieve the COM stored within a record.
+    * @param i is the index of the record.
+    * @return the COM cached at writing time.
+    */
+    Vec2 read_COM(const size_t i) const;
+};
+
+/**
+ * Outcome of one solve.
+ */
+struct SolveResult {
+    std::vector<Force> forces;
+    Vec2 F;
+    double T{0.};
+    int32_t status{0};
+    int32_t iterations{0};
+    double time_us{0.};
+};
+
+/**
+ * Writer of columnar result files, mapped in memory so that
+ * distinct records can be filled concurrently and in any order.
+ */
+class ResultWriter
+{
+    MappedFile file;
+    size_t num_contacts{0};
+    uint64_t count{0};
+    std::vector<double*> f64;
+    std::vector<int32_t*> i32;
+
+public:
+   /**
+    * Create the file, sized for all the records.
+    * @param path is the file path.
+    * @param count is the number of records.
+    * @param num_contacts is the number of contacts per record.
+    * @return true/false on success/failure.
+    */
+    bool open(const std::string &path, const size_t count,
+              const size_t num_contacts=2);
+
+   /**
+    * Retrieve the number of records.
+    * @return the number of records.
+    */
+    size_t size() const;
+
+   /**
+    * Retrieve the number of contacts per record.
+    * @return the number of contacts.
+    */
+    size_t get_num_contacts() const;
+
+   /**
+    * Store a record.
+    * @param i is the index of the record.
+    * @param result is the outcome of the solve.
+    */
+    void write(const size_t i, const SolveResult &result);
+};
+
+/**
+ * Solve a whole corpus streaming it in chunks through the batch solver.
+ * @param corpus is the problem corpus.
+ * @param solver is the batch solver.
+ * @param results is the writer, sized as the corpus.
+ * @param chunk is the number of problems configured at once.
+ * @return true/false on success/failure.
+ */
+bool solve_corpus(const CorpusReader &corpus, BatchSolver &solver,
+                  ResultWriter &results, const size_t chunk=1024);
+
+}
+
+#endif
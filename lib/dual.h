@@ -0,0 +1,281 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <cstddef>
+#include <cmath>
+
+namespace problem_ns {
+
+/**
+ * Forward-mode automatic differentiation in one variable.
+ *
+ * A Dual<N> is the Taylor polynomial of order N of a quantity f around
+ * the point of evaluation, stored through the normalized coefficients
+ * c[k]=f^(k)/k!, so that products boil down to convolutions. Dual<1>
+ * is the classic dual number a+b*eps with eps^2=0, while higher orders
+ * carry the higher derivatives along in the same pass.
+ *
+ * The type is trivially copyable and lives on the stack.
+ */
+template<size_t N>
+struct Dual {
+    double c[N+1];
+
+    Dual() = default;
+
+    /**
+     * Build a constant, with all the derivatives set to zero.
+     * @param v is the value.
+     */
+    explicit Dual(const double v)
+    {
+        c[0]=v;
+        for (size_t k=1; k<=N; k++) {
+            c[k]=0.;
+        }
+    }
+
+    /**
+     * Build the independent variable.
+     * @param v is the point of evaluation.
+     * @return the polynomial with unit first derivative.
+     */
+    static Dual variable(const double v)
+    {
+        Dual d(v);
+        if (N>0) {
+            d.c[1]=1.;
+        }
+        return d;
+    }
+
+    /**
+     * Retrieve the value.
+     */
+    double value() const { return c[0]; }
+
+    /**
+     * Retrieve the derivative of order k<=N.
+     */
+    double derivative(const size_t k) const
+    {
+        double f=1.;
+        for (size_t j=2; j<=k; j++) {
+            f*=j;
+        }
+        return f*c[k];
+    }
+
+    Dual& operator+=(const Dual &b) { for (size_t k=0; k<=N; k++) c[k]+=b.c[k]; return *this; }
+    Dual& operator-=(const Dual &b) { for (size_t k=0; k<=N; k++) c[k]-=b.c[k]; return *this; }
+    Dual& operator+=(const double b) { c[0]+=b; return *this; }
+    Dual& operator-=(const double b) { c[0]-=b; return *this; }
+    Dual& operator*=(const double b) { for (size_t k=0; k<=N; k++) c[k]*=b; return *this; }
+
+    friend Dual operator+(Dual a, const Dual &b) { return a+=b; }
+    friend Dual operator-(Dual a, const Dual &b) { return a-=b; }
+    friend Dual operator+(Dual a, const double b) { return a+=b; }
+    friend Dual operator-(Dual a, const double b) { return a-=b; }
+    friend Dual operator+(const double a, Dual b) { return b+=a; }
+    friend Dual operator-(const double a, const Dual &b) { return Dual(a)-b; }
+    friend Dual operator-(Dual a) { return a*=-1.; }
+    friend Dual operator*(Dual a, const double b) { return a*=b; }
+    friend Dual operator*(const double a, Dual b) { return b*=a; }
+
+    friend Dual operator*(const Dual &a, const Dual &b)
+    {
+        Dual d;
+        for (size_t k=0; k<=N; k++) {
+            auto acc=a.c[0]*b.c[k];
+            for (size_t j=1; j<=k; j++) {
+                acc+=a.c[j]*b.c[k-j];
+            }
+            d.c[k]=acc;
+        }
+        return d;
+    }
+
+    /**
+     * Division, from the recurrence that follows from a=q*b.
+     */
+    friend Dual operator/(const Dual &a, const Dual &b)
+    {
+        Dual q;
+        auto ib=1./b.c[0];
+        for (size_t k=0; k<=N; k++) {
+            auto acc=a.c[k];
+            for (size_t j=1; j<=k; j++) {
+                acc-=b.c[j]*q.c[k-j];
+            }
+            q.c[k]=acc*ib;
+        }
+        return q;
+    }
+
+    /**
+     * Square root, from the recurrence that follows from a=q*q.
+     */
+    friend Dual sqrt(const Dual &a)
+    {
+        Dual q;
+        q.c[0]=std::sqrt(a.c[0]);
+        auto iq=.5/q.c[0];
+        for (size_t k=1; k<=N; k++) {
+            auto acc=a.c[k];
+            for (size_t j=1; j<k; j++) {
+                acc-=q.c[j]*q.c[k-j];
+            }
+            q.c[k]=acc*iq;
+        }
+        return q;
+    }
+
+    /**
+     * Square, exploiting the symmetry of the convolution.
+     */
+    friend Dual sqr(const Dual &a)
+    {
+        Dual d;
+        for (size_t k=0; k<=N; k++) {
+            auto acc=(k%2==0?a.c[k/2]*a.c[k/2]:0.);
+            for (size_t j=0; 2*j<k; j++) {
+                acc+=2.*a.c[j]*a.c[k-j];
+            }
+            d.c[k]=acc;
+        }
+        return d;
+    }
+
+    /**
+     * Scaled exponential k*exp(a), from the recurrence that follows
+     * from e'=a'*e, which holds whatever the scale.
+     */
+    friend Dual scaled_exp(const Dual &a, const double k)
+    {
+        Dual e;
+        e.c[0]=k*std::exp(a.c[0]);
+        for (size_t n=1; n<=N; n++) {
+            auto acc=a.c[1]*e.c[n-1];
+            for (size_t j=2; j<=n; j++) {
+                acc+=j*a.c[j]*e.c[n-j];
+            }
+            e.c[n]=acc*(1./n);
+        }
+        return e;
+    }
+
+    /**
+     * Exponential.
+     */
+    friend Dual exp(const Dual &a)
+    {
+        return scaled_exp(a,1.);
+    }
+
+    /**
+     * Sine and cosine, from the recurrences that follow
+     * from s'=a'*c and c'=-a'*s.
+     */
+    friend void sincos(const Dual &a, Dual &s, Dual &co)
+    {
+        // locals, as the outputs might alias the input
+        Dual ls,lc;
+        ls.c[0]=std::sin(a.c[0]);
+        lc.c[0]=std::cos(a.c[0]);
+        for (size_t k=1; k<=N; k++) {
+            auto acc_s=a.c[1]*lc.c[k-1];
+            auto acc_c=-a.c[1]*ls.c[k-1];
+            for (size_t j=2; j<=k; j++) {
+                acc_s+=j*a.c[j]*lc.c[k-j];
+                acc_c-=j*a.c[j]*ls.c[k-j];
+            }
+            ls.c[k]=acc_s*(1./k);
+            lc.c[k]=acc_c*(1./k);
+        }
+        s=ls;
+        co=lc;
+    }
+};
+
+/**
+ * Differentiate a Taylor polynomial, losing one order.
+ */
+template<size_t N>
+Dual<N-1> derivative(const Dual<N> &a)
+{
+    Dual<N-1> d;
+    for (size_t k=0; k<N; k++) {
+        d.c[k]=(k+1)*a.c[k+1];
+    }
+    return d;
+}
+
+/**
+ * Truncate a Taylor polynomial to a lower order M<=N.
+ */
+template<size_t M, size_t N>
+Dual<M> truncate(const Dual<N> &a)
+{
+    static_assert(M<=N,"cannot truncate to a higher order");
+    Dual<M> d;
+    for (size_t k=0; k<=M; k++) {
+        d.c[k]=a.c[k];
+    }
+    return d;
+}
+
+/**
+ * Compose Taylor polynomials: given f in the variable t and t=g(u),
+ * work out f(g(u)) in the variable u. The value of g is the point
+ * where f is expanded, hence it is not used.
+ */
+template<size_t N>
+Dual<N> compose(const Dual<N> &f, const Dual<N> &g)
+{
+    auto d=g;
+    d.c[0]=0.;
+    Dual<N> h(f.c[N]);
+    for (size_t k=N; k>0; k--) {
+        h=h*d;
+        h.c[0]+=f.c[k-1];
+    }
+    return h;
+}
+
+/**
+ * Value of a scalar, which lets the same code run on doubles and duals.
+ */
+inline double value_of(const double a) { return a; }
+
+/**
+ * Value of a Taylor polynomial.
+ */
+template<size_t N>
+double value_of(const Dual<N> &a) { return a.value(); }
+
+/**
+ * Scaled exponential k*exp(a) of a double.
+ */
+inline double scaled_exp(const double a, const double k) { return k*std::exp(a); }
+
+/**
+ * Square of a double.
+ */
+inline double sqr(const double a) { return a*a; }
+
+/**
+ * Sine and cosine of a double.
+ */
+inline void sincos(const double a, double &s, double &co)
+{
+    s=std::sin(a);
+    co=std::cos(a);
+}
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cmath>
+#include "generator.h"
+
+using namespace std;
+using namespace problem_ns;
+
+namespace {
+
+/***************************************************/
+class SplitMix64
+{
+    uint64_t state;
+
+public:
+    /***************************************************/
+    explicit SplitMix64(const uint64_t state_) : state(state_) { }
+
+    /***************************************************/
+    uint64_t operator()()
+    {
+        auto z=(state+=0x9e3779b97f4a7c15ULL);
+        z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+        z=(z^(z>>27))*0x94d049bb133111ebULL;
+        return z^(z>>31);
+    }
+
+    /***************************************************/
+    double uniform(const double a, const double b)
+    {
+        // 53 random bits mapped onto [a,b)
+        return a+(b-a)*((*this)()>>11)*(1./9007199254740992.);
+    }
+};
+
+}
+
+/***************************************************/
+Generator::Generator(const uint64_t seed, const size_t num_lobes) :
+    seed(seed), num_lobes(num_lobes)
+{
+    assert(num_lobes>0);
+}
+
+/***************************************************/
+uint64_t Generator::get_seed() const
+{
+    return seed;
+}
+
+/***************************************************/
+uint64_t Generator::tell() const
+{
+    return next;
+}
+
+/***************************************************/
+void Generator::seek(const uint64_t index)
+{
+    next=index;
+}
+
+/***************************************************/
+void Generator::generate_at(const uint64_t index, Problem &problem) const
+{
+    // key the engine on <seed,index> by scrambling them together
+    SplitMix64 key(seed);
+    SplitMix64 rng(key()^(index*0xd1b54a32d192ed03ULL));
+
+    vector<double> ci(num_lobes);
+    for (auto &c:ci) {
+        c=rng.uniform(-.3,.3);
+    }
+    auto friction=rng.uniform(.5,1.);
+
+    Force F;
+    F.t=rng.uniform(0.,2.*M_PI);
+    F.fn=rng.uniform(.1,1.);
+    auto f=friction*F.fn;
+    F.ft=rng.uniform(-f,f);
+
+    problem.configure(ci,friction,F);
+}
+
+/***************************************************/
+void Generator::generate(Problem &problem)
+{
+    generate_at(next++,problem);
+}
+
+/***************************************************/
+void Generator::generate_n(Problem *problems, const size_t n, ThreadPool *pool)
+{
+    auto first=next;
+    if (pool!=nullptr) {
+        pool->parallel_for(n,[&](const size_t, const size_t i) {
+            generate_at(first+i,problems[i]);
+        });
+    } else {
+        for (size_t i=0; i<n; i++) {
+            generate_at(first+i,problems[i]);
+        }
+    }
+    next+=n;
+}
+
+/***************************************************/
+void Generator::generate_n(vector<Problem> &problems, ThreadPool *pool)
+{
+    generate_n(problems.data(),problems.size(),pool);
+}
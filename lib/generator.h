@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "problem.h"
+#include "pool.h"
+
+namespace problem_ns {
+
+/**
+ * Seeded generator of random problems.
+ *
+ * Problems form a stream indexed by an integer: the i-th problem
+ * depends only on the seed and on i, being drawn from a counter-based
+ * engine (SplitMix64) keyed on the pair. Therefore, any split of the
+ * stream across threads yields the same problems, and regenerating a
+ * corpus from the same seed is reproducible bit by bit.
+ *
+ * Distributions are the same as Problem::generate().
+ */
+class Generator
+{
+    uint64_t seed;
+    size_t num_lobes;
+    uint64_t next{0};
+
+public:
+   /**
+    * Constructor.
+    * @param seed is the seed of the stream.
+    * @param num_lobes is the number of lobes of the object's perimeter.
+    */
+    explicit Generator(const uint64_t seed, const size_t num_lobes=4);
+
+   /**
+    * Retrieve the seed.
+    * @return the seed.
+    */
+    uint64_t get_seed() const;
+
+   /**
+    * Retrieve the index of the next problem of the stream.
+    * @return the index.
+    */
+    uint64_t tell() const;
+
+   /**
+    * Move within the stream.
+    * @param index is the index of the next problem to generate.
+    */
+    void seek(const uint64_t index);
+
+   /**
+    * Generate the problem at a given index of the stream.
+    * @param index is the index.
+    * @param problem is the caller-provided problem to configure.
+    */
+    void generate_at(const uint64_t index, Problem &problem) const;
+
+   /**
+    * Generate the next problem of the stream.
+    * @param problem is the caller-provided problem to configure.
+    */
+    void generate(Problem &problem);
+
+   /**
+    * Generate the next n problems of the stream.
+    * @param problems is the caller-provided array of at least n problems.
+    * @param n is the number of problems.
+    * @param pool is an optional pool used to generate in parallel.
+    */
+    void generate_n(Problem *problems, const size_t n, ThreadPool *pool=nullptr);
+
+   /**
+    * Generate the next problems of the stream, filling a vector.
+    * @param problems is the caller-provided vector, whose size
+    *        determines the number of problems.
+    * @param pool is an optional pool used to generate in parallel.
+    */
+    void generate_n(std::vector<Problem> &problems, ThreadPool *pool=nullptr);
+};
+
+}
+
+#endif
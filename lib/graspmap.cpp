@@ -0,0 +1,107 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cmath>
+#include "contact.h"
+#include "graspmap.h"
+
+using namespace std;
+using namespace problem_ns;
+
+/***************************************************/
+GraspMap::GraspMap(const Problem& problem, const size_t resolution_,
+                   ThreadPool *pool) : resolution(resolution_),
+                   cells(resolution*resolution)
+{
+    assert(resolution>0);
+
+    // frames are shared by all the cells of the same row/column
+    vector<Frame> frames(resolution);
+    for (size_t i=0; i<resolution; i++) {
+        frames[i]=problem.eval_frame(get_angle(i));
+    }
+
+    if (pool!=nullptr) {
+        pool->parallel_for(resolution,[&](const size_t, const size_t i) {
+            compute_row(problem,frames,i);
+        });
+    } else {
+        for (size_t i=0; i<resolution; i++) {
+            compute_row(problem,frames,i);
+        }
+    }
+
+    // smallest residual first, then smallest effort
+    auto effort=[](const Cell& c) { return c.fn1*c.fn1+c.ft1*c.ft1+c.fn2*c.fn2+c.ft2*c.ft2; };
+    for (size_t k=1; k<cells.size(); k++) {
+        auto d=cells[k].residual-cells[best].residual;
+        if ((d<-1e-9) || ((d<1e-9) && (effort(cells[k])<effort(cells[best])))) {
+            best=k;
+        }
+    }
+}
+
+/***************************************************/
+void GraspMap::compute_row(const Problem& problem, const vector<Frame>& frames,
+                           const size_t i)
+{
+    const auto &w0=problem.get_F_wrench();
+    for (size_t j=0; j<resolution; j++) {
+        auto sol=ContactSolver::solve_fixed(problem,frames[i],frames[j],w0.F,w0.T);
+        auto &cell=cells[i*resolution+j];
+        cell.residual=sol.residual;
+        cell.fn1=sol.forces[0].fn;
+        cell.ft1=sol.forces[0].ft;
+        cell.fn2=sol.forces[1].fn;
+        cell.ft2=sol.forces[1].ft;
+    }
+}
+
+/***************************************************/
+size_t GraspMap::get_resolution() const
+{
+    return resolution;
+}
+
+/***************************************************/
+double GraspMap::get_angle(const size_t i) const
+{
+    return (2.*M_PI*i)/resolution;
+}
+
+/***************************************************/
+const GraspMap::Cell& GraspMap::at(const size_t i, const size_t j) const
+{
+    assert((i<resolution) && (j<resolution));
+    return cells[i*resolution+j];
+}
+
+/***************************************************/
+const GraspMap::Cell& GraspMap::lookup(const double t1, const double t2) const
+{
+    auto index=[&](const double t) {
+        auto i=(size_t)lround(Problem::wrap_angle(t)*resolution/(2.*M_PI));
+        return (i%resolution);
+    };
+    return at(index(t1),index(t2));
+}
+
+/***************************************************/
+const vector<GraspMap::Cell>& GraspMap::get_cells() const
+{
+    return cells;
+}
+
+/***************************************************/
+vector<Force> GraspMap::get_seed() const
+{
+    auto i=best/resolution;
+    auto j=best%resolution;
+    const auto &cell=cells[best];
+    return vector<Force>{Force{get_angle(i),cell.fn1,cell.ft1},
+                         Force{get_angle(j),cell.fn2,cell.ft2}};
+}
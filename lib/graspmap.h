@@ -0,0 +1,101 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef GRASPMAP_H
+#define GRASPMAP_H
+
+#include <cstddef>
+#include <vector>
+#include "problem.h"
+#include "pool.h"
+
+namespace problem_ns {
+
+/**
+ * Grasp-feasibility map of a Problem.
+ *
+ * The two contact angles are sampled over a uniform grid and,
+ * for each cell (t1,t2), the forces within the friction cones
+ * that best balance F are worked out from the linear sub-problem
+ * obtained by keeping the contact locations fixed.
+ */
+class GraspMap
+{
+public:
+    /**
+     * Content of a cell: the residual norm of Newton's law
+     * (force and torque stacked) and the forces attaining it.
+     */
+    struct Cell {
+        double residual{0.};
+        double fn1{0.};
+        double ft1{0.};
+        double fn2{0.};
+        double ft2{0.};
+    };
+
+private:
+    size_t resolution;
+    std::vector<Cell> cells;
+    size_t best{0};
+
+    void compute_row(const Problem& problem, const std::vector<Frame>& frames,
+                     const size_t i);
+
+public:
+   /**
+    * Build the map.
+    * @param problem is the configured problem.
+    * @param resolution is the number of samples per contact angle.
+    * @param pool is an optional pool used to compute rows in parallel.
+    */
+    GraspMap(const Problem& problem, const size_t resolution,
+             ThreadPool *pool=nullptr);
+
+   /**
+    * Retrieve the number of samples per contact angle.
+    * @return the resolution.
+    */
+    size_t get_resolution() const;
+
+   /**
+    * Retrieve the contact angle corresponding to a grid index.
+    * @param i is the index.
+    * @return the angle.
+    */
+    double get_angle(const size_t i) const;
+
+   /**
+    * Access a cell through its indexes.
+    * @param i is the index of t1.
+    * @param j is the index of t2.
+    * @return the cell.
+    */
+    const Cell& at(const size_t i, const size_t j) const;
+
+   /**
+    * Access the cell nearest to the given contact angles.
+    * @param t1 is the first contact angle.
+    * @param t2 is the second contact angle.
+    * @return the cell.
+    */
+    const Cell& lookup(const double t1, const double t2) const;
+
+   /**
+    * Retrieve all the cells stored row-major (t1 along rows).
+    * @return the cells.
+    */
+    const std::vector<Cell>& get_cells() const;
+
+   /**
+    * Retrieve the forces of the cell with the smallest residual,
+    * to be used as starting point of the solver.
+    * @return a vector containing the two forces.
+    */
+    std::vector<Force> get_seed() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <algorithm>
+#include "pool.h"
+
+using namespace std;
+using namespace problem_ns;
+
+/***************************************************/
+ThreadPool::ThreadPool(const size_t num_workers)
+{
+    auto n=(num_workers>0?num_workers:std::max(1U,thread::hardware_concurrency()));
+    for (size_t i=0; i<n; i++) {
+        ranges.emplace_back(new Range);
+    }
+    for (size_t i=0; i<n; i++) {
+        workers.emplace_back(&ThreadPool::loop,this,i);
+    }
+}
+
+/***************************************************/
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lck(mtx);
+        closing=true;
+    }
+    cv_work.notify_all();
+    for (auto &w:workers) {
+        w.join();
+    }
+}
+
+/***************************************************/
+size_t ThreadPool::size() const
+{
+    return workers.size();
+}
+
+/***************************************************/
+bool ThreadPool::pop(const size_t worker, size_t &i)
+{
+    auto &r=*ranges[worker];
+    lock_guard<mutex> lck(r.mtx);
+    if (r.begin<r.end) {
+        i=r.begin++;
+        return true;
+    }
+    return false;
+}
+
+/***************************************************/
+bool ThreadPool::steal(const size_t worker)
+{
+    // pick the victim with the largest amount of work left
+    size_t victim=worker, largest=0;
+    for (size_t v=0; v<ranges.size(); v++) {
+        if (v!=worker) {
+            lock_guard<mutex> lck(ranges[v]->mtx);
+            auto left=ranges[v]->end-ranges[v]->begin;
+            if (left>largest) {
+                largest=left;
+                victim=v;
+            }
+        }
+    }
+    if (victim==worker) {
+        return false;
+    }
+
+    size_t begin, end;
+    {
+        auto &r=*ranges[victim];
+        lock_guard<mutex> lck(r.mtx);
+        auto left=r.end-r.begin;
+        if (left==0) {
+            // the victim has been drained meanwhile: retry
+            return true;
+        }
+        end=r.end;
+        r.end-=(left+1)/2;
+        begin=r.end;
+    }
+
+    auto &r=*ranges[worker];
+    lock_guard<mutex> lck(r.mtx);
+    r.begin=begin;
+    r.end=end;
+    return true;
+}
+
+/***************************************************/
+void ThreadPool::abort(exception_ptr e)
+{
+    {
+        lock_guard<mutex> lck(mtx);
+        if (!error) {
+            error=e;
+        }
+    }
+
+    // drain the ranges so that no worker starts further items
+    for (auto &r:ranges) {
+        lock_guard<mutex> lck(r->mtx);
+        r->begin=r->end;
+    }
+}
+
+/***************************************************/
+void ThreadPool::loop(const size_t worker)
+{
+    size_t seen=0;
+    while (true) {
+        const function<void(const size_t, const size_t)> *fn;
+        {
+            unique_lock<mutex> lck(mtx);
+            cv_work.wait(lck,[&]() { return closing || (generation!=seen); });
+            if (closing) {
+                return;
+            }
+            seen=generation;
+            fn=job;
+        }
+
+        size_t i;
+        do {
+            while (pop(worker,i)) {
+                // exceptions escaping a thread would terminate the program
+                try {
+                    (*fn)(worker,i);
+                } catch (...) {
+                    abort(current_exception());
+                }
+            }
+        } while (steal(worker));
+
+        {
+            lock_guard<mutex> lck(mtx);
+            busy--;
+        }
+        cv_done.notify_all();
+    }
+}
+
+/***************************************************/
+void ThreadPool::parallel_for(const size_t n,
+                              const function<void(const size_t, const size_t)> &fn)
+{
+    lock_guard<mutex> lck_call(mtx_call);
+
+    // static partition, then balancing via stealing
+    auto num=ranges.size();
+    for (size_t w=0; w<num; w++) {
+        lock_guard<mutex> lck(ranges[w]->mtx);
+        ranges[w]->begin=(n*w)/num;
+        ranges[w]->end=(n*(w+1))/num;
+    }
+
+    unique_lock<mutex> lck(mtx);
+    job=&fn;
+    busy=num;
+    generation++;
+    cv_work.notify_all();
+    cv_done.wait(lck,[&]() { return (busy==0); });
+    job=nullptr;
+    if (error) {
+        exception_ptr e;
+        swap(e,error);
+        rethrow_exception(e);
+    }
+}
@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace problem_ns {
+
+/**
+ * Pool of persistent worker threads.
+ *
+ * Work submitted through parallel_for() is split in contiguous
+ * per-worker ranges: each worker consumes its own range from
+ * the front and, once idle, steals half of the largest range
+ * left to the others from the back. The first exception thrown by
+ * the work cancels the items not started yet and is rethrown to the
+ * caller of parallel_for() once the workers are done.
+ */
+class ThreadPool
+{
+    struct Range {
+        std::mutex mtx;
+        size_t begin{0};
+        size_t end{0};
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Range>> ranges;
+    std::mutex mtx, mtx_call;
+    std::condition_variable cv_work, cv_done;
+    const std::function<void(const size_t, const size_t)> *job{nullptr};
+    std::exception_ptr error;
+    size_t generation{0};
+    size_t busy{0};
+    bool closing{false};
+
+    bool pop(const size_t worker, size_t &i);
+    bool steal(const size_t worker);
+    void abort(std::exception_ptr e);
+    void loop(const size_t worker);
+
+public:
+   /**
+    * Constructor.
+    * @param num_workers is the number of threads; 0 means as many
+    *        as the hardware concurrency.
+    */
+    explicit ThreadPool(const size_t num_workers=0);
+
+   /**
+    * Destructor, joining the threads.
+    */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+   /**
+    * Retrieve the number of workers.
+    * @return the number of workers.
+    */
+    size_t size() const;
+
+   /**
+    * Run fn(worker,i) for all i in [0,n), blocking until completion.
+    * @param n is the number of work items.
+    * @param fn is the function to execute, which receives the index
+    *        of the worker running it and the index of the item.
+    *
+    * @note Calls to parallel_for() are serialized.
+    * @note If fn throws, the first exception is rethrown here after
+    *       the items already running complete; the others are skipped.
+    */
+    void parallel_for(const size_t n,
+                      const std::function<void(const size_t, const size_t)> &fn);
+};
+
+}
+
+#endif
@@ -6,94 +6,139 @@
 #include <cassert>
 
 #include <algorithm>
+#include <array>
 #include <random>
-#include <functional>
+#include <type_traits>
 #include <yarp/math/Math.h>
-#include <gsl/gsl_integration.h>
 #include "problem.h"
+#include "generator.h"
 
 using namespace std;
 using namespace yarp::sig;
 using namespace yarp::math;
 using namespace problem_ns;
 
-namespace problem_ns {
+static_assert(is_trivially_copyable<Vec2>::value,"Vec2 must be trivially copyable");
+
+namespace {
 
 /***************************************************/
-double integrand_M(double t, void* params)
+template<size_t N>
+struct GaussLegendre
 {
-    Problem *problem=static_cast<Problem*>(params);
-    assert(problem);
-    auto r2=norm2(problem->get_P(t));
-    return (sqrt(r2)/2.);
+    array<double,N> x;
+    array<double,N> w;
+
+    /***************************************************/
+    GaussLegendre()
+    {
+        // roots of the Legendre polynomial via Newton iterations
+        for (size_t i=0; i<N; i++) {
+            auto z=cos(M_PI*(i+.75)/(N+.5));
+            double dp;
+            for (int iter=0; iter<100; iter++) {
+                double p0=1., p1=0.;
+                for (size_t j=1; j<=N; j++) {
+                    auto p2=p1;
+                    p1=p0;
+                    p0=((2.*j-1.)*z*p1-(j-1.)*p2)/j;
+                }
+                dp=N*(z*p0-p1)/(z*z-1.);
+                auto dz=p0/dp;
+                z-=dz;
+                if (fabs(dz)<1e-15) {
+                    break;
+                }
+            }
+            x[i]=z;
+            w[i]=2./((1.-z*z)*dp*dp);
+        }
+    }
+};
+
 }
 
-double integrand_COMx(double t, void* params)
+/***************************************************/
+bool Problem::configure(const vector<double> &shape,
+                        const double friction,
+                        const Force &F)
 {
-    Problem *problem=static_cast<Problem*>(params);
-    assert(problem);
-    auto r2=norm2(problem->get_P(t));
-    return ((r2*cos(t))/3.);
-} 
+    return configure(shape,vector<double>(shape.size(),.8/std::max<size_t>(shape.size(),1)),
+                     friction,F);
+}
 
-double integrand_COMy(double t, void* params)
+/***************************************************/
+bool Problem::configure(const vector<double> &shape,
+                        const vector<double> &widths,
+                        const double friction,
+                        const Force &F)
 {
-    Problem *problem=static_cast<Problem*>(params);
-    assert(problem);
-    auto r2=norm2(problem->get_P(t));
-    return ((r2*sin(t))/3.);
-} 
+    return configure(shape,widths,nullptr,friction,F);
+}
 
+/***************************************************/
+bool Problem::configure(const vector<double> &shape,
+                        const vector<double> &widths,
+                        const Vec2 &COM,
+                        const double friction,
+                        const Force &F)
+{
+    return configure(shape,widths,&COM,friction,F);
 }
 
 /***************************************************/
 bool Problem::configure(const vector<double> &shape,
+                        const vector<double> &widths,
+                        const Vec2 *COM_,
                         const double friction,
                         const Force &F)
 {
+    // the geometry depends on the shape only, hence it is kept
+    // when just the load changes
+    auto same_shape=configured && (shape==ci) && (widths==si);
     configured=false;
-    if ((shape.size()==ci.size()) &&
+    if (!shape.empty() && (widths.size()==shape.size()) &&
+        all_of(begin(widths),end(widths),[](const double s) { return (s>0.); }) &&
         (friction>=0.) && (friction<=1.)) {
-        ci=shape;
-        this->friction=friction;
-        this->F=F;
-        auto ft_max=this->friction*fabs(this->F.fn);
-        this->F.ft=std::max(-ft_max,std::min(this->F.ft,ft_max));
+        if (!same_shape) {
+            auto K=shape.size();
+            ti.resize(K);
+            for (size_t k=0; k<K; k++) {
+                ti[k]=(2.*k+1.)*M_PI/K;
+            }
+            si=widths;
+            ci=shape;
+            circle=all_of(begin(ci),end(ci),[](const double c) { return (c==0.); });
+            build_sectors();
+            com=(COM_!=nullptr?*COM_:calc_COM());
+            COM=com.toVector();
+        }
         configured=true;
-        COM=calc_COM();
+        configure_load(friction,F);
     }
     return configured;
 }
 
 /***************************************************/
-shared_ptr<Problem> Problem::generate()
+bool Problem::configure_load(const double friction, const Force &F)
+{
+    if (!configured || (friction<0.) || (friction>1.)) {
+        return false;
+    }
+    this->friction=friction;
+    this->F=F;
+    auto ft_max=this->friction*fabs(this->F.fn);
+    this->F.ft=std::max(-ft_max,std::min(this->F.ft,ft_max));
+    wrench0=calc_wrench0();
+    return true;
+}
+
+/***************************************************/
+shared_ptr<Problem> Problem::generate(const size_t num_lobes)
 {
     random_device rnd_device;
-    mt19937 mersenne_engine(rnd_device());
-    
-    uniform_real_distribution<double> dist_ci(-.3,.3);
-    uniform_real_distribution<double> dist_friction(.5,1.);
-    uniform_real_distribution<double> dist_Ft(0.,2.*M_PI);
-    uniform_real_distribution<double> dist_Ffn(.1,1.);
-    
-    auto gen_ci=bind(dist_ci,mersenne_engine);
-    auto gen_friction=bind(dist_friction,mersenne_engine);
-    auto gen_Ft=bind(dist_Ft,mersenne_engine);
-    auto gen_Ffn=bind(dist_Ffn,mersenne_engine);
-    
-    vector<double> ci(4);
-    std::generate(begin(ci),end(ci),gen_ci);
-    auto friction=gen_friction();
-
-    auto Ffn=gen_Ffn();	
-    auto f=friction*Ffn;	
-    uniform_real_distribution<double> dist_Fft(-f,f);	
-    auto gen_Fft=bind(dist_Fft,mersenne_engine);	
-
-    Force F{.t=gen_Ft(),.fn=Ffn,.ft=gen_Fft()};
-
-    auto problem=shared_ptr<Problem>(new Problem);
-    problem->configure(ci,friction,F);
+    auto problem=make_shared<Problem>();
+    Generator(((uint64_t)rnd_device()<<32)|rnd_device(),num_lobes).generate(*problem);
     return problem;
 }
 
@@ -108,50 +153,201 @@ double Problem::wrap_angle(const double t)
 }
 
 /***************************************************/
-size_t Problem::get_quadrant(const double t) const
+size_t Problem::get_sector(const double t) const
 {
-    auto q=(size_t)floor(t/(M_PI/2.));
+    auto q=(size_t)floor(t*ti.size()/(2.*M_PI));
     q%=ti.size();
     return q;
 }
 
 /***************************************************/
-tuple<double,size_t,double> Problem::calc_quantities(const double t) const
+void Problem::build_sectors()
+{
+    // lobes are truncated beyond cutoff*s, where the Gaussian falls below
+    // ~2.5e-7: this way, the 4 lobes of width 0.2 keep lying each within
+    // its own quadrant, as in the original model
+    const auto cutoff=3.9;
+    auto K=ti.size();
+    auto h=2.*M_PI/K;
+
+    // list the lobes overlapping each sector along with their centers,
+    // considering also the copies shifted by 2*PI to account for wrapping
+    vector<vector<pair<size_t,double>>> lists(K);
+    for (size_t q=0; q<K; q++) {
+        auto tm=(q+.5)*h;
+        for (size_t k=0; k<K; k++) {
+            for (auto shift:{0.,-2.*M_PI,2.*M_PI}) {
+                auto tk=ti[k]+shift;
+                if (((k==q) && (shift==0.)) ||
+                    ((ci[k]!=0.) && (fabs(tk-tm)<h/2.+cutoff*si[k]))) {
+                    lists[q].emplace_back(k,tk);
+                }
+            }
+        }
+    }
+
+    auto stride=size_t(1);
+    for (auto &l:lists) {
+        stride=std::max(stride,l.size());
+    }
+
+    sectors.stride=stride;
+    sectors.t.assign(K*stride,0.);
+    sectors.is.assign(K*stride,1.);
+    sectors.c.assign(K*stride,0.);
+    for (size_t q=0; q<K; q++) {
+        for (size_t m=0; m<lists[q].size(); m++) {
+            auto &l=lists[q][m];
+            sectors.t[q*stride+m]=l.second;
+            sectors.is[q*stride+m]=1./si[l.first];
+            sectors.c[q*stride+m]=ci[l.first];
+        }
+        for (size_t m=lists[q].size(); m<stride; m++) {
+            sectors.t[q*stride+m]=(q+.5)*h;
+        }
+    }
+}
+
+/***************************************************/
+inline Problem::Radius Problem::sum_lobes(const size_t q, const double t,
+                                          const size_t num) const
 {
-    auto q=get_quadrant(t);
-    auto te=(t-ti[q])/si[q];
-    auto r=1.+ci[q]*exp(-te*te);
-    assert(!isnan(te) && !isnan(r));
-    return make_tuple(r,q,te);
+    const auto *lt=&sectors.t[q*num];
+    const auto *ls=&sectors.is[q*num];
+    const auto *lc=&sectors.c[q*num];
+    Radius rad;
+    for (size_t m=0; m<num; m++) {
+        auto k=(t-lt[m])*ls[m];
+        auto g=lc[m]*exp(-k*k);
+        auto ks=k*ls[m];
+        auto is2=ls[m]*ls[m];
+        rad.r+=g;
+        rad.r1-=2.*g*ks;
+        rad.r2+=g*(4.*ks*ks-2.*is2);
+        rad.r3+=g*ks*(12.*is2-8.*ks*ks);
+    }
+    return rad;
 }
 
 /***************************************************/
-Vector Problem::calc_COM()
+template<size_t M>
+Problem::Radius Problem::sum_lobes(const size_t q, const double t) const
 {
-    size_t limit=10000;
-    auto ws=gsl_integration_workspace_alloc(limit);
-    auto integrand=shared_ptr<gsl_function>(new gsl_function);
-    integrand->params=static_cast<void*>(this);
+    // M is known at compile time, hence the loop gets unrolled
+    return sum_lobes(q,t,M);
+}
 
-    double epsabs=.0001;
-    double epsrel=.001;
-    double abserr;
+/***************************************************/
+Problem::Radius Problem::calc_radius(const double t) const
+{
+    if (circle) {
+        return Radius();
+    }
 
-    double area;
-    integrand->function=&integrand_M;
-    gsl_integration_qag(integrand.get(),0.,2.*M_PI,epsabs,epsrel,limit,GSL_INTEG_GAUSS61,ws,&area,&abserr);
+    auto q=get_sector(t);
+    Radius rad;
+    switch (sectors.stride) {
+    case 1:
+        rad=sum_lobes<1>(q,t);
+        break;
+    case 2:
+        rad=sum_lobes<2>(q,t);
+        break;
+    case 3:
+        rad=sum_lobes<3>(q,t);
+        break;
+    case 4:
+        rad=sum_lobes<4>(q,t);
+        break;
+    default:
+        rad=sum_lobes(q,t,sectors.stride);
+    }
+    assert(!isnan(rad.r) && !isnan(rad.r1));
+    return rad;
+}
 
-    Vector COM(2);
-    integrand->function=&integrand_COMx;
-    gsl_integration_qag(integrand.get(),0.,2.*M_PI,epsabs,epsrel,limit,GSL_INTEG_GAUSS61,ws,&COM[0],&abserr);
+/***************************************************/
+template<typename S>
+S Problem::sum_lobes_r(const size_t q, const S& t, const size_t num) const
+{
+    // same model as sum_lobes() on Radius, but generic in the scalar
+    // type so that the derivatives can be worked out automatically
+    const auto *lt=&sectors.t[q*num];
+    const auto *ls=&sectors.is[q*num];
+    const auto *lc=&sectors.c[q*num];
+    S r(1.);
+    for (size_t m=0; m<num; m++) {
+        auto k=(t-lt[m])*ls[m];
+        r+=scaled_exp(-sqr(k),lc[m]);
+    }
+    return r;
+}
+
+/***************************************************/
+template<typename S>
+S Problem::calc_r(const S& t) const
+{
+    if (circle) {
+        return S(1.);
+    }
 
-    integrand->function=&integrand_COMy;
-    gsl_integration_qag(integrand.get(),0.,2.*M_PI,epsabs,epsrel,limit,GSL_INTEG_GAUSS61,ws,&COM[1],&abserr);
+    auto q=get_sector(value_of(t));
+    switch (sectors.stride) {
+    case 1:
+        return sum_lobes_r(q,t,1);
+    case 2:
+        return sum_lobes_r(q,t,2);
+    case 3:
+        return sum_lobes_r(q,t,3);
+    case 4:
+        return sum_lobes_r(q,t,4);
+    default:
+        return sum_lobes_r(q,t,sectors.stride);
+    }
+}
+
+/***************************************************/
+Vec2 Problem::calc_COM()
+{
+    if (circle) {
+        return Vec2(0.,0.);
+    }
 
-    gsl_integration_workspace_free(ws);
+    // the integrand is smooth within each sector, hence a fixed-order
+    // Gauss-Legendre rule accumulating all the moments at once attains
+    // ~1e-8 accuracy, with one radius evaluation per node, as long as
+    // it spans no more than panel_ratio times the narrowest lobe: wider
+    // sectors are thus split into as many panels as needed
+    static const GaussLegendre<20> gl;
+    const auto panel_ratio=8.;
+    auto K=ti.size();
+    auto H=2.*M_PI/K;
+
+    double area=0.;
+    Vec2 COM;
+    for (size_t q=0; q<K; q++) {
+        auto s=H/panel_ratio;
+        for (size_t m=0; m<sectors.stride; m++) {
+            if (sectors.c[q*sectors.stride+m]!=0.) {
+                s=std::min(s,1./sectors.is[q*sectors.stride+m]);
+            }
+        }
+        auto num_panels=(size_t)ceil(H/(panel_ratio*s));
+        auto h=H/(2.*num_panels);
+        for (size_t j=0; j<num_panels; j++) {
+            auto tm=q*H+(2.*j+1.)*h;
+            for (size_t i=0; i<gl.x.size(); i++) {
+                auto t=tm+h*gl.x[i];
+                auto r=calc_radius(t).r;
+                auto w=h*gl.w[i];
+                area+=w*r/2.;
+                COM+=(w*r*r/3.)*Vec2(cos(t),sin(t));
+            }
+        }
+    }
 
     COM/=area;
-    assert(!isnan(COM[0]) && !isnan(COM[1]));
+    assert(!isnan(COM.x) && !isnan(COM.y));
     return COM;
 }
 
@@ -162,6 +358,20 @@ const vector<double>& Problem::get_shape() const
     return ci;
 }
 
+/***************************************************/
+const vector<double>& Problem::get_widths() const
+{
+    assert(configured);
+    return si;
+}
+
+/***************************************************/
+bool Problem::is_circle() const
+{
+    assert(configured);
+    return circle;
+}
+
 /***************************************************/
 double Problem::get_friction() const
 {
@@ -184,109 +394,277 @@ const Vector& Problem::get_COM() const
 }
 
 /***************************************************/
-Vector Problem::get_P(const double t) const
+const Vec2& Problem::eval_COM() const
+{
+    assert(configured);
+    return com;
+}
+
+/***************************************************/
+Vec2 Problem::eval_P(const double t) const
 {
     assert(configured);
     auto tw=wrap_angle(t);
-    auto qnt=calc_quantities(tw);
-    auto &r=get<0>(qnt);
-    Vector P(2);
-    P[0]=r*cos(tw);
-    P[1]=r*sin(tw);
-    assert(!isnan(P[0]) && !isnan(P[1]));
+    auto r=calc_radius(tw).r;
+    Vec2 P(r*cos(tw),r*sin(tw));
+    assert(!isnan(P.x) && !isnan(P.y));
     return P;
 }
 
 /***************************************************/
-Vector Problem::get_dP(const double t) const
+Vec2 Problem::eval_dP(const double t) const
 {
     assert(configured);
     auto tw=wrap_angle(t);
-    auto qnt=calc_quantities(tw);
-    auto &r=get<0>(qnt);
-    auto &q=get<1>(qnt);
-    auto &twe=get<2>(qnt);
-    Vector dP(2);
-    dP[0]=(r-1.)*(-2.*twe/si[q])*cos(tw)-r*sin(tw);
-    dP[1]=(r-1.)*(-2.*twe/si[q])*sin(tw)+r*cos(tw);
-    assert(!isnan(dP[0]) && !isnan(dP[1]));
+    auto rad=calc_radius(tw);
+    Vec2 dP(rad.r1*cos(tw)-rad.r*sin(tw),
+            rad.r1*sin(tw)+rad.r*cos(tw));
+    assert(!isnan(dP.x) && !isnan(dP.y));
     return dP;
 }
 
 /***************************************************/
-Vector Problem::get_d2P(const double t) const
+Vec2 Problem::eval_d2P(const double t) const
 {
     assert(configured);
     auto tw=wrap_angle(t);
-    auto qnt=calc_quantities(tw);
-    auto &r=get<0>(qnt);
-    auto &q=get<1>(qnt);
-    auto &twe=get<2>(qnt);
-    Vector d2P(2);
-    d2P[0]=(r-1.)*4.*(twe/si[q])*(twe/si[q])*cos(tw)
-           +(r-1.)*(-2./(si[q]*si[q]))*cos(tw)
-           -(r-1.)*(-2.*twe/si[q])*sin(tw)
-           -(r-1.)*(-2.*twe/si[q])*sin(tw)
-           -r*cos(tw);
-    d2P[1]=(r-1.)*4.*(twe/si[q])*(twe/si[q])*sin(tw)
-           +(r-1.)*(-2./(si[q]*si[q]))*sin(tw)
-           +(r-1.)*(-2.*twe/si[q])*cos(tw)
-           +(r-1.)*(-2.*twe/si[q])*cos(tw)
-           -r*sin(tw);
-    assert(!isnan(d2P[0]) && !isnan(d2P[1]));
+    auto rad=calc_radius(tw);
+    Vec2 d2P((rad.r2-rad.r)*cos(tw)-2.*rad.r1*sin(tw),
+             (rad.r2-rad.r)*sin(tw)+2.*rad.r1*cos(tw));
+    assert(!isnan(d2P.x) && !isnan(d2P.y));
     return d2P;
 }
 
+/***************************************************/
+Vec2 Problem::eval_d3P(const double t) const
+{
+    return eval_frame(t).d3P;
+}
+
+/***************************************************/
+Vec2 Problem::eval_T(const double t) const
+{
+    return eval_dP(t);
+}
+
+/***************************************************/
+Vec2 Problem::eval_dT(const double t) const
+{
+    return eval_d2P(t);
+}
+
+/***************************************************/
+Vec2 Problem::eval_N(const double t) const
+{
+    return eval_dP(t).perp();
+}
+
+/***************************************************/
+Vec2 Problem::eval_dN(const double t) const
+{
+    return eval_d2P(t).perp();
+}
+
+/***************************************************/
+Frame Problem::eval_frame(const double t) const
+{
+    assert(configured);
+    auto tw=wrap_angle(t);
+
+    // radius and its derivatives wrt t
+    auto rad=calc_radius(tw);
+    auto &r=rad.r;
+    auto &r1=rad.r1;
+    auto &r2=rad.r2;
+    auto &r3=rad.r3;
+
+    // cos and sin of the same argument get fused by the compiler
+    Vec2 u(cos(tw),sin(tw));
+    auto up=u.perp();
+
+    Frame frame;
+    frame.P=r*u;
+    frame.dP=r1*u+r*up;
+    frame.d2P=(r2-r)*u+2.*r1*up;
+    frame.d3P=(r3-3.*r1)*u+(3.*r2-r)*up;
+    frame.T=frame.dP;
+    frame.dT=frame.d2P;
+    frame.d2T=frame.d3P;
+    frame.N=frame.dP.perp();
+    frame.dN=frame.d2P.perp();
+    frame.d2N=frame.d3P.perp();
+    assert(!isnan(frame.d3P.x) && !isnan(frame.d3P.y));
+    return frame;
+}
+
+/***************************************************/
+Vector Problem::get_P(const double t) const
+{
+    return eval_P(t).toVector();
+}
+
+/***************************************************/
+Vector Problem::get_dP(const double t) const
+{
+    return eval_dP(t).toVector();
+}
+
+/***************************************************/
+Vector Problem::get_d2P(const double t) const
+{
+    return eval_d2P(t).toVector();
+}
+
 /***************************************************/
 Vector Problem::get_T(const double t) const
 {
-    return get_dP(t);
+    return eval_T(t).toVector();
 }
 
 /***************************************************/
 Vector Problem::get_dT(const double t) const
 {
-    return get_d2P(t);
+    return eval_dT(t).toVector();
 }
 
 /***************************************************/
 Vector Problem::get_N(const double t) const
 {
-    auto dP=get_dP(t);
-    Vector N(2);
-    N[0]=-dP[1];
-    N[1]=dP[0];
-    return N;
+    return eval_N(t).toVector();
 }
 
 /***************************************************/
 Vector Problem::get_dN(const double t) const
 {
-    auto d2P=get_d2P(t);
-    Vector dN(2);
-    dN[0]=-d2P[1];
-    dN[1]=d2P[0];
-    return dN;
+    return eval_dN(t).toVector();
+}
+
+/***************************************************/
+template<size_t N>
+WrenchJet<N> Problem::eval_wrench_jet(const double t) const
+{
+    assert(configured);
+
+    // P=r*u with u=(cos(t),sin(t)), hence T=dP/dt=r'*u+r*u.perp():
+    // only the radius is needed up to one order more
+    auto tw=Dual<N>::variable(wrap_angle(t));
+    auto rad=calc_r(Dual<N+1>::variable(tw.value()));
+    auto r=truncate<N>(rad);
+    auto r1=derivative(rad);
+    Dual<N> s,c;
+    sincos(tw,s,c);
+    auto Tx=r1*c-r*s;
+    auto Ty=r1*s+r*c;
+
+    // N=T.perp(), torques are cross(P-COM,N)=r*r'-cross(COM,N) and
+    // cross(P-COM,T)=r^2-cross(COM,T)
+    WrenchJet<N> jet;
+    jet.normal[0]=-Ty;
+    jet.normal[1]=Tx;
+    jet.normal[2]=r*r1-(com.x*Tx+com.y*Ty);
+    jet.tangential[0]=Tx;
+    jet.tangential[1]=Ty;
+    jet.tangential[2]=sqr(r)-(com.x*Ty-com.y*Tx);
+    assert(!isnan(jet.normal[2].value()) && !isnan(jet.tangential[2].value()));
+    return jet;
+}
+
+template WrenchJet<0> Problem::eval_wrench_jet<0>(const double) const;
+template WrenchJet<1> Problem::eval_wrench_jet<1>(const double) const;
+template WrenchJet<2> Problem::eval_wrench_jet<2>(const double) const;
+template WrenchJet<3> Problem::eval_wrench_jet<3>(const double) const;
+
+/***************************************************/
+Wrench Problem::calc_wrench0() const
+{
+    auto frame=eval_frame(F.t);
+    Wrench wrench;
+    wrench.F=F.fn*frame.N+F.ft*frame.T;
+    wrench.T=cross(frame.P-com,wrench.F);
+    return wrench;
+}
+
+/***************************************************/
+const Wrench& Problem::get_F_wrench() const
+{
+    assert(configured);
+    return wrench0;
+}
+
+/***************************************************/
+void Problem::eval_wrench(const Force *forces, const size_t n, Wrench &wrench,
+                          const bool gradient) const
+{
+    assert(configured);
+    wrench.F=wrench0.F;
+    wrench.T=wrench0.T;
+
+    if (gradient) {
+        wrench.dF.resize(3*n);
+        wrench.dT.resize(3*n);
+        for (size_t i=0; i<n; i++) {
+            auto &f=forces[i];
+            auto jet=eval_wrench_jet<1>(f.t);
+            for (size_t j=0; j<3; j++) {
+                // value and derivative wrt t of the wrench component j
+                auto w=f.fn*jet.normal[j]+f.ft*jet.tangential[j];
+                if (j<2) {
+                    (j==0?wrench.F.x:wrench.F.y)+=w.c[0];
+                    (j==0?wrench.dF[3*i].x:wrench.dF[3*i].y)=w.c[1];
+                    (j==0?wrench.dF[3*i+1].x:wrench.dF[3*i+1].y)=jet.normal[j].c[0];
+                    (j==0?wrench.dF[3*i+2].x:wrench.dF[3*i+2].y)=jet.tangential[j].c[0];
+                } else {
+                    wrench.T+=w.c[0];
+                    wrench.dT[3*i]=w.c[1];
+                    wrench.dT[3*i+1]=jet.normal[j].c[0];
+                    wrench.dT[3*i+2]=jet.tangential[j].c[0];
+                }
+            }
+        }
+        return;
+    }
+
+    // the contacts are sampled in batch, within a stack buffer for the
+    // usual small number of fingers
+    double local[9*8];
+    vector<double> heap;
+    auto *t=local;
+    if (n>8) {
+        heap.resize(9*n);
+        t=heap.data();
+    }
+    auto *fn=t+n, *ft=t+2*n;
+    SamplesSoA s{t+3*n,t+4*n,t+5*n,t+6*n,t+7*n,t+8*n};
+    for (size_t i=0; i<n; i++) {
+        t[i]=forces[i].t;
+        fn[i]=forces[i].fn;
+        ft[i]=forces[i].ft;
+    }
+    eval_batch(t,n,s);
+
+    // accumulate the wrench in one pass over the structure of arrays
+    double Fx=0., Fy=0., T=0.;
+    for (size_t i=0; i<n; i++) {
+        auto fx=fn[i]*s.Nx[i]+ft[i]*s.Tx[i];
+        auto fy=fn[i]*s.Ny[i]+ft[i]*s.Ty[i];
+
+        // linear (x,y axes)
+        Fx+=fx;
+        Fy+=fy;
+
+        // rotation (z-axis)
+        T+=(s.Px[i]-com.x)*fy-(s.Py[i]-com.y)*fx;
+    }
+    wrench.F+=Vec2(Fx,Fy);
+    wrench.T+=T;
 }
 
 /***************************************************/
 pair<Vector,double> Problem::compute_newton_law(const vector<Force>& forces) const
 {
-    assert(forces.size()==2);
-
-    // linear (x,y axes)
-    auto Ftot=F.fn*get_N(F.t)+forces[0].fn*get_N(forces[0].t)+forces[1].fn*get_N(forces[1].t)+
-              F.ft*get_T(F.t)+forces[0].ft*get_T(forces[0].t)+forces[1].ft*get_T(forces[1].t);
-
-    // rotation (z-axis)
-    auto Ttot=(get_P(F.t)-COM)[0]*(F.fn*get_N(F.t)[1]+F.ft*get_T(F.t)[1])-
-              (get_P(F.t)-COM)[1]*(F.fn*get_N(F.t)[0]+F.ft*get_T(F.t)[0])+
-              (get_P(forces[0].t)-COM)[0]*(forces[0].fn*get_N(forces[0].t)[1]+forces[0].ft*get_T(forces[0].t)[1])-
-              (get_P(forces[0].t)-COM)[1]*(forces[0].fn*get_N(forces[0].t)[0]+forces[0].ft*get_T(forces[0].t)[0])+
-              (get_P(forces[1].t)-COM)[0]*(forces[1].fn*get_N(forces[1].t)[1]+forces[1].ft*get_T(forces[1].t)[1])-
-              (get_P(forces[1].t)-COM)[1]*(forces[1].fn*get_N(forces[1].t)[0]+forces[1].ft*get_T(forces[1].t)[0]);
-    
-    return make_pair(Ftot,Ttot);
+    Wrench wrench;
+    eval_wrench(forces.data(),forces.size(),wrench,false);
+    return make_pair(wrench.F.toVector(),wrench.T);
 }
 
 /***************************************************/
@@ -13,9 +13,109 @@
 #include <cmath>
 #include <algorithm>
 #include <yarp/sig/Vector.h>
+#include "dual.h"
 
 namespace problem_ns {
 
+/**
+ * Fixed-size 2D vector.
+ *
+ * Trivially-copyable value type used by the allocation-free
+ * geometry API; it lives on the stack and can be converted
+ * to a YARP vector when needed.
+ */
+struct Vec2 {
+    double x{0.};
+    double y{0.};
+
+    Vec2() = default;
+    Vec2(const double x_, const double y_) : x(x_), y(y_) { }
+
+    Vec2& operator+=(const Vec2 &v) { x+=v.x; y+=v.y; return *this; }
+    Vec2& operator-=(const Vec2 &v) { x-=v.x; y-=v.y; return *this; }
+    Vec2& operator*=(const double k) { x*=k; y*=k; return *this; }
+    Vec2& operator/=(const double k) { x/=k; y/=k; return *this; }
+
+    friend Vec2 operator+(const Vec2 &a, const Vec2 &b) { return Vec2(a.x+b.x,a.y+b.y); }
+    friend Vec2 operator-(const Vec2 &a, const Vec2 &b) { return Vec2(a.x-b.x,a.y-b.y); }
+    friend Vec2 operator-(const Vec2 &a) { return Vec2(-a.x,-a.y); }
+    friend Vec2 operator*(const double k, const Vec2 &a) { return Vec2(k*a.x,k*a.y); }
+    friend Vec2 operator*(const Vec2 &a, const double k) { return Vec2(k*a.x,k*a.y); }
+    friend Vec2 operator/(const Vec2 &a, const double k) { return Vec2(a.x/k,a.y/k); }
+
+    /**
+     * Dot product between 2D vectors.
+     */
+    friend double dot(const Vec2 &a, const Vec2 &b) { return a.x*b.x+a.y*b.y; }
+
+    /**
+     * z-component of the cross product between 2D vectors.
+     */
+    friend double cross(const Vec2 &a, const Vec2 &b) { return a.x*b.y-a.y*b.x; }
+
+    /**
+     * Squared norm of a 2D vector.
+     */
+    friend double norm2(const Vec2 &a) { return dot(a,a); }
+
+    /**
+     * Norm of a 2D vector.
+     */
+    friend double norm(const Vec2 &a) { return std::sqrt(norm2(a)); }
+
+    /**
+     * Rotate the vector by +90 degrees.
+     * @return the vector (-y,x).
+     */
+    Vec2 perp() const { return Vec2(-y,x); }
+
+    /**
+     * Convert to a YARP vector.
+     * @return a YARP vector containing the x and y coordinates.
+     */
+    yarp::sig::Vector toVector() const
+    {
+        yarp::sig::Vector v(2);
+        v[0]=x; v[1]=y;
+        return v;
+    }
+};
+
+/**
+ * Surface frame at a given location t of the object's perimeter.
+ *
+ * It gathers the point P, its derivatives and the tangent/normal
+ * vectors (along with their derivatives) all evaluated at the same t.
+ */
+struct Frame {
+    Vec2 P;
+    Vec2 dP;
+    Vec2 d2P;
+    Vec2 d3P;
+    Vec2 T;
+    Vec2 dT;
+    Vec2 d2T;
+    Vec2 N;
+    Vec2 dN;
+    Vec2 d2N;
+};
+
+/**
+ * Structure-of-arrays view over caller-provided storage
+ * used to sample the perimeter in batch.
+ *
+ * Each array must be able to hold as many doubles as the
+ * number of requested samples.
+ */
+struct SamplesSoA {
+    double *Px{nullptr};
+    double *Py{nullptr};
+    double *Nx{nullptr};
+    double *Ny{nullptr};
+    double *Tx{nullptr};
+    double *Ty{nullptr};
+};
+
 /**
  * Descriptor of the force acting on the object.
  *
@@ -35,40 +135,159 @@ struct Force {
     double ft{0.};
 };
 
+/**
+ * Wrench acting on the object: total force F and torque T about the COM.
+ *
+ * When requested, the gradients wrt the variables <t,fn,ft> of each
+ * contact are stored as well, three consecutive entries per contact.
+ */
+struct Wrench {
+    Vec2 F;
+    double T{0.};
+    std::vector<Vec2> dF;
+    std::vector<double> dT;
+};
+
+/**
+ * Wrench <Fx,Fy,T> exerted at a contact by unit normal and tangential
+ * forces, given as Taylor polynomials of order N in the location t.
+ *
+ * The wrench of a contact <t,fn,ft> is fn*normal+ft*tangential: being
+ * linear in fn and ft, all its derivatives up to the order N wrt the
+ * contact variables follow from these coefficients.
+ */
+template<size_t N>
+struct WrenchJet {
+    Dual<N> normal[3];
+    Dual<N> tangential[3];
+};
+
 /**
  * Problem API.
+ *
+ * The object's perimeter has radius r(t)=1+sum_k c_k*exp(-((t-t_k)/s_k)^2)
+ * over K lobes; lobes are truncated where negligible, so that evaluating
+ * r(t) only sums the few lobes indexed by the sector containing t.
+ *
+ * @note Once configured, a Problem can be safely read from multiple
+ *       threads through its const methods, as they do not touch any
+ *       mutable state; configure() requires exclusive access instead.
  */
 class Problem
 {
+    /**
+     * Radius of the object's perimeter and its derivatives wrt t.
+     */
+    struct Radius {
+        double r{1.};
+        double r1{0.};
+        double r2{0.};
+        double r3{0.};
+    };
+
+    /**
+     * Sector-to-lobe index: each of the K sectors of width 2*PI/K
+     * lists the lobes whose support overlaps with it, padded to the
+     * same length with zero-amplitude lobes. Lobe centers are stored
+     * shifted by 2*PI when they wrap and widths are stored inverted.
+     */
+    struct SectorIndex {
+        size_t stride{1};
+        std::vector<double> t;
+        std::vector<double> is;
+        std::vector<double> c;
+    };
+
     bool configured{false};
+    bool circle{false};
     std::vector<double> ti{M_PI/4.0, 3.0*M_PI/4.0, 5.0*M_PI/4.0, 7.0*M_PI/4.0};
     std::vector<double> si{.2, .2, .2, .2};
     std::vector<double> ci{0., 0., 0., 0.};
+    SectorIndex sectors;
     yarp::sig::Vector COM=yarp::sig::Vector(2,0.);
+    Vec2 com;
     double friction{0.};
     Force F;
+    Wrench wrench0;
 
-    size_t get_quadrant(const double t) const;
-    std::tuple<double,size_t,double> calc_quantities(const double t) const;
-    yarp::sig::Vector calc_COM();
+    size_t get_sector(const double t) const;
+    void build_sectors();
+    Radius sum_lobes(const size_t q, const double t, const size_t num) const;
+    template<size_t M>
+    Radius sum_lobes(const size_t q, const double t) const;
+    Radius calc_radius(const double t) const;
+    template<typename S>
+    S sum_lobes_r(const size_t q, const S& t, const size_t num) const;
+    template<typename S>
+    S calc_r(const S& t) const;
+    Vec2 calc_COM();
+    Wrench calc_wrench0() const;
     yarp::sig::Vector get_d2P(const double t) const;
+    bool configure(const std::vector<double> &shape, const std::vector<double> &widths,
+                   const Vec2 *COM_, const double friction, const Force &F);
 
 public:
    /**
     * Configure the problem.
-    * @param shape is a 4D vector containing the coefficients of the object's perimeter.
+    * @param shape is a K-dimensional vector containing the amplitudes of the
+    *        K lobes of the object's perimeter, centered at (2k+1)*PI/K.
     * @param friction is in range [0,1].
     * @param F is the applied force.    
     * @return true/false on success/failure.
+    *
+    * @note Lobe widths default to 0.8/K, i.e. 0.2 for the original 4 lobes.
     */
     bool configure(const std::vector<double> &shape, const double friction,
                    const Force &F);
 
+   /**
+    * Configure the problem specifying the lobe widths.
+    * @param shape is a K-dimensional vector containing the amplitudes of the
+    *        K lobes of the object's perimeter, centered at (2k+1)*PI/K.
+    * @param widths is a K-dimensional vector containing the lobe widths.
+    * @param friction is in range [0,1].
+    * @param F is the applied force.
+    * @return true/false on success/failure.
+    */
+    bool configure(const std::vector<double> &shape, const std::vector<double> &widths,
+                   const double friction, const Force &F);
+
+   /**
+    * Configure the problem with a precomputed COM, skipping its
+    * quadrature, e.g. when reading corpora (see CorpusReader::read()).
+    * @param shape is a K-dimensional vector containing the amplitudes of the
+    *        K lobes of the object's perimeter, centered at (2k+1)*PI/K.
+    * @param widths is a K-dimensional vector containing the lobe widths.
+    * @param COM is the COM of the shape, as computed by a previous
+    *        configure() with the same shape and widths.
+    * @param friction is in range [0,1].
+    * @param F is the applied force.
+    * @return true/false on success/failure.
+    */
+    bool configure(const std::vector<double> &shape, const std::vector<double> &widths,
+                   const Vec2 &COM, const double friction, const Force &F);
+
+   /**
+    * Configure the friction and the applied force only, keeping the
+    * shape along with its geometry (sector index and COM).
+    * @param friction is in range [0,1].
+    * @param F is the applied force.
+    * @return true/false on success/failure; the problem must have been
+    *         configured already.
+    *
+    * @note configure() itself skips the geometry when the shape and
+    *       the widths are unchanged.
+    */
+    bool configure_load(const double friction, const Force &F);
+
    /**
     * Generate a random problem.
+    * @param num_lobes is the number of lobes of the object's perimeter.
     * @return the problem.
+    *
+    * @note Use Generator for reproducible streams of problems.
     */
-    static std::shared_ptr<Problem> generate();
+    static std::shared_ptr<Problem> generate(const size_t num_lobes=4);
 
    /**
     * Helper function that returns the parameter t within the interval [0, 2*PI].
@@ -83,6 +302,20 @@ public:
     */
     const std::vector<double>& get_shape() const;
 
+   /**
+    * Retrieve the current vector of lobe widths.
+    * @return the lobe widths.
+    */
+    const std::vector<double>& get_widths() const;
+
+   /**
+    * Check whether the object's perimeter is a unit circle, i.e. all the
+    * coefficients are zero. In this case, the geometry is computed in
+    * closed form and the COM lies at the origin.
+    * @return true for circles.
+    */
+    bool is_circle() const;
+
    /**
     * Retrieve the friction value.
     * @return the friction.
@@ -100,6 +333,68 @@ public:
     * @return a YARP vector containing the x and y coordinates.
     */
     const yarp::sig::Vector& get_COM() const;
+
+   /**
+    * Allocation-free version of get_COM().
+    * @return the x and y coordinates of the COM.
+    */
+    const Vec2& eval_COM() const;
+
+   /**
+    * Allocation-free version of get_P().
+    * @param t is the parameter.
+    * @return the x and y coordinates of P.
+    */
+    Vec2 eval_P(const double t) const;
+
+   /**
+    * Allocation-free version of get_dP().
+    * @param t is the parameter.
+    * @return the x and y coordinates of dP.
+    */
+    Vec2 eval_dP(const double t) const;
+
+   /**
+    * Retrieve the second derivative of the point P on the object's perimeter.
+    * @param t is the parameter.
+    * @return the x and y coordinates of d2P.
+    */
+    Vec2 eval_d2P(const double t) const;
+
+   /**
+    * Retrieve the third derivative of the point P on the object's perimeter.
+    * @param t is the parameter.
+    * @return the x and y coordinates of d3P.
+    */
+    Vec2 eval_d3P(const double t) const;
+
+   /**
+    * Allocation-free version of get_T().
+    * @param t is the parameter.
+    * @return the x and y coordinates of T.
+    */
+    Vec2 eval_T(const double t) const;
+
+   /**
+    * Allocation-free version of get_dT().
+    * @param t is the parameter.
+    * @return the x and y coordinates of dT.
+    */
+    Vec2 eval_dT(const double t) const;
+
+   /**
+    * Allocation-free version of get_N().
+    * @param t is the parameter.
+    * @return the x and y coordinates of N.
+    */
+    Vec2 eval_N(const double t) const;
+
+   /**
+    * Allocation-free version of get_dN().
+    * @param t is the parameter.
+    * @return the x and y coordinates of dN.
+    */
+    Vec2 eval_dN(const double t) const;
         
    /**
     * Retrieve the point P on the object's perimeter.
@@ -149,9 +444,65 @@ public:
     */
     yarp::sig::Vector get_dN(const double t) const;
 
+   /**
+    * Retrieve the whole surface frame on the object's perimeter.
+    * @param t is the parameter.
+    * @return the frame containing P, its derivatives up to the third order,
+    *         T, N and their derivatives up to the second order.
+    *
+    * @note Quantities are computed in one pass, sharing the
+    *       angle wrapping, the exponential and the trigonometry.
+    */
+    Frame eval_frame(const double t) const;
+
+   /**
+    * Sample P, N and T on the object's perimeter in batch.
+    * @param t is the contiguous array of parameters.
+    * @param n is the number of parameters.
+    * @param out is the structure-of-arrays receiving the samples.
+    *
+    * @note SIMD kernels (AVX2) are used when available at runtime,
+    *       with a scalar fallback otherwise.
+    */
+    void eval_batch(const double *t, const size_t n,
+                    const SamplesSoA &out) const;
+
+   /**
+    * Evaluate the wrench exerted at a contact along with its derivatives.
+    * @param t is the contact location.
+    * @return the wrench due to unit normal and tangential forces, as
+    *         Taylor polynomials of order N in t.
+    *
+    * @note The perimeter is differentiated automatically through Dual
+    *       numbers; orders N<=3 are available.
+    */
+    template<size_t N>
+    WrenchJet<N> eval_wrench_jet(const double t) const;
+
+   /**
+    * Retrieve the wrench due to the applied force F alone,
+    * which is computed once at configure().
+    * @return the wrench, without gradients.
+    */
+    const Wrench& get_F_wrench() const;
+
+   /**
+    * Compute the total wrench acting on the object due to F and input forces.
+    * @param forces is the array of the inward forces, one per contact.
+    * @param n is the number of forces.
+    * @param wrench receives the result; its storage is reused across calls.
+    * @param gradient to compute also the gradients wrt the contact variables.
+    *
+    * @note Each contact is evaluated once, while the contribution of F is
+    *       cached. Without gradients, contacts are sampled in batch;
+    *       gradients come from eval_wrench_jet().
+    */
+    void eval_wrench(const Force *forces, const size_t n, Wrench &wrench,
+                     const bool gradient=true) const;
+
    /**
     * Compute the total force and torque acting on the object due to F and input forces.
-    * @param forces is the 2D vector of the inward forces.
+    * @param forces is the vector of the inward forces, one per contact.
     * @return a pair representing the total force and torque.
     */
     std::pair<yarp::sig::Vector,double> compute_newton_law(const std::vector<Force>& forces) const;
@@ -0,0 +1,208 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#undef NDEBUG
+#include <cassert>
+
+#include <cmath>
+#include "problem.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PROBLEM_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace problem_ns;
+
+namespace {
+
+#ifdef PROBLEM_AVX2_KERNEL
+/***************************************************/
+__attribute__((target("avx2,fma")))
+inline __m256d poly(const __m256d x, const double *c, const int n)
+{
+    auto y=_mm256_set1_pd(c[0]);
+    for (int i=1; i<n; i++) {
+        y=_mm256_fmadd_pd(y,x,_mm256_set1_pd(c[i]));
+    }
+    return y;
+}
+
+/***************************************************/
+__attribute__((target("avx2,fma")))
+inline __m256d exp_pd(__m256d x)
+{
+    // Cephes exp: x=n*ln2+r, |r|<=ln2/2, exp(r) via Pade approximant
+    static const double P[]={1.26177193074810590878E-4,3.02994407707441961300E-2,
+                             9.99999999999999999910E-1};
+    static const double Q[]={3.00198505138664455042E-6,2.52448340349684104192E-3,
+                             2.27265548208155028766E-1,2.00000000000000000009E0};
+
+    x=_mm256_max_pd(x,_mm256_set1_pd(-708.));
+    x=_mm256_min_pd(x,_mm256_set1_pd(708.));
+    auto n=_mm256_round_pd(_mm256_mul_pd(x,_mm256_set1_pd(M_LOG2E)),
+                           _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+    x=_mm256_fnmadd_pd(n,_mm256_set1_pd(6.93145751953125E-1),x);
+    x=_mm256_fnmadd_pd(n,_mm256_set1_pd(1.42860682030941723212E-6),x);
+
+    auto xx=_mm256_mul_pd(x,x);
+    auto px=_mm256_mul_pd(x,poly(xx,P,3));
+    auto e=_mm256_div_pd(px,_mm256_sub_pd(poly(xx,Q,4),px));
+    e=_mm256_fmadd_pd(_mm256_set1_pd(2.),e,_mm256_set1_pd(1.));
+
+    // scale by 2^n acting directly on the exponent bits
+    auto magic=_mm256_set1_pd(6755399441055744.0);
+    auto ni=_mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n,magic)),
+                             _mm256_castpd_si256(magic));
+    auto pow2n=_mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(ni,_mm256_set1_epi64x(1023)),52));
+    return _mm256_mul_pd(e,pow2n);
+}
+
+/***************************************************/
+__attribute__((target("avx2,fma")))
+inline void sincos_pd(const __m256d x, __m256d &s, __m256d &c)
+{
+    // Cephes sin/cos: reduction by PI/2, then polynomials on |y|<=PI/4
+    static const double S[]={1.58962301576546568060E-10,-2.50507477628578072866E-8,
+                             2.75573136213857245213E-6,-1.98412698295895385996E-4,
+                             8.33333333332211858878E-3,-1.66666666666666307295E-1};
+    static const double C[]={-1.13585365213876817300E-11,2.08757008419747316778E-9,
+                             -2.75573141792967388112E-7,2.48015872888517045348E-5,
+                             -1.38888888888730564116E-3,4.16666666666665929218E-2};
+
+    auto j=_mm256_round_pd(_mm256_mul_pd(x,_mm256_set1_pd(M_2_PI)),
+                           _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+    auto y=_mm256_fnmadd_pd(j,_mm256_set1_pd(1.57079632673412561417E0),x);
+    y=_mm256_fnmadd_pd(j,_mm256_set1_pd(6.07710050650619224932E-11),y);
+
+    auto z=_mm256_mul_pd(y,y);
+    auto sy=_mm256_fmadd_pd(_mm256_mul_pd(y,z),poly(z,S,6),y);
+    auto cy=_mm256_fmadd_pd(_mm256_mul_pd(z,z),poly(z,C,6),
+                            _mm256_fnmadd_pd(_mm256_set1_pd(.5),z,_mm256_set1_pd(1.)));
+
+    // select (blendv looks at the sign bit only) and flip signs according to the quadrant
+    auto ji=_mm256_cvtpd_epi32(j);
+    auto swap=_mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_slli_epi32(_mm_and_si128(ji,_mm_set1_epi32(1)),31)));
+    auto ss=_mm256_blendv_pd(sy,cy,swap);
+    auto cc=_mm256_blendv_pd(cy,sy,swap);
+
+    auto sign_s=_mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(
+                _mm_srli_epi32(_mm_and_si128(ji,_mm_set1_epi32(2)),1)),63));
+    auto sign_c=_mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(
+                _mm_srli_epi32(_mm_and_si128(_mm_add_epi32(ji,_mm_set1_epi32(1)),_mm_set1_epi32(2)),1)),63));
+    s=_mm256_xor_pd(ss,sign_s);
+    c=_mm256_xor_pd(cc,sign_c);
+}
+
+/***************************************************/
+__attribute__((target("avx2,fma")))
+inline __m256d gather_pd(const double *base, const __m128i idx)
+{
+    // the masked gather with an explicit zero source keeps GCC from
+    // warning about the uninitialized source of _mm256_i32gather_pd
+    const auto all=_mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(),base,idx,all,8);
+}
+
+/***************************************************/
+__attribute__((target("avx2,fma")))
+size_t eval_batch_avx2(const size_t K, const size_t M, const double *lt,
+                       const double *ls, const double *lc, const bool circle,
+                       const double *t, const size_t n, const SamplesSoA &out)
+{
+    const auto two_pi=_mm256_set1_pd(2.*M_PI);
+    const auto one=_mm256_set1_pd(1.);
+    const auto num_sectors=_mm256_set1_pd((double)K);
+    const auto last=_mm_set1_epi32((int)K-1);
+    const auto stride=_mm_set1_epi32((int)M);
+    size_t i=0;
+    for (; i+4<=n; i+=4) {
+        auto tv=_mm256_loadu_pd(t+i);
+
+        // wrap within [0,2*PI)
+        auto tw=_mm256_fnmadd_pd(two_pi,_mm256_floor_pd(_mm256_div_pd(tv,two_pi)),tv);
+        tw=_mm256_andnot_pd(_mm256_cmp_pd(tw,two_pi,_CMP_GE_OQ),tw);
+
+        // the circle has unit radius
+        auto r=one;
+        auto r1=_mm256_setzero_pd();
+        if (!circle) {
+            // sector lookup, rounded as in get_sector(): truncated lobes make
+            // the radius jump slightly across boundaries, thus samples lying
+            // on them must pick the same sector as the scalar path
+            auto q=_mm256_cvttpd_epi32(_mm256_div_pd(_mm256_mul_pd(tw,num_sectors),two_pi));
+            q=_mm_min_epi32(q,last);
+            q=_mm_mullo_epi32(q,stride);
+
+            // Gaussian lobes on the radius
+            for (size_t m=0; m<M; m++) {
+                auto idx=_mm_add_epi32(q,_mm_set1_epi32((int)m));
+                auto tq=gather_pd(lt,idx);
+                auto isq=gather_pd(ls,idx);
+                auto cq=gather_pd(lc,idx);
+                auto k=_mm256_mul_pd(_mm256_sub_pd(tw,tq),isq);
+                auto k2=_mm256_mul_pd(k,k);
+                auto g=_mm256_mul_pd(cq,exp_pd(_mm256_sub_pd(_mm256_setzero_pd(),k2)));
+                r=_mm256_add_pd(r,g);
+                r1=_mm256_fnmadd_pd(_mm256_set1_pd(2.),_mm256_mul_pd(_mm256_mul_pd(g,k),isq),r1);
+            }
+        }
+
+        __m256d s,c;
+        sincos_pd(tw,s,c);
+
+        auto Px=_mm256_mul_pd(r,c);
+        auto Py=_mm256_mul_pd(r,s);
+        auto Tx=_mm256_fmsub_pd(r1,c,Py);
+        auto Ty=_mm256_fmadd_pd(r1,s,Px);
+
+        _mm256_storeu_pd(out.Px+i,Px);
+        _mm256_storeu_pd(out.Py+i,Py);
+        _mm256_storeu_pd(out.Tx+i,Tx);
+        _mm256_storeu_pd(out.Ty+i,Ty);
+        _mm256_storeu_pd(out.Nx+i,_mm256_sub_pd(_mm256_setzero_pd(),Ty));
+        _mm256_storeu_pd(out.Ny+i,Tx);
+    }
+    return i;
+}
+#endif
+
+}
+
+/***************************************************/
+void Problem::eval_batch(const double *t, const size_t n,
+                         const SamplesSoA &out) const
+{
+    assert(configured);
+    assert((out.Px!=nullptr) && (out.Py!=nullptr) &&
+           (out.Nx!=nullptr) && (out.Ny!=nullptr) &&
+           (out.Tx!=nullptr) && (out.Ty!=nullptr));
+
+    size_t i=0;
+#ifdef PROBLEM_AVX2_KERNEL
+    static const bool has_avx2=__builtin_cpu_supports("avx2") &&
+                               __builtin_cpu_supports("fma");
+    if (has_avx2) {
+        i=eval_batch_avx2(ti.size(),sectors.stride,sectors.t.data(),sectors.is.data(),
+                          sectors.c.data(),circle,t,n,out);
+    }
+#endif
+
+    // scalar fallback and tail
+    for (; i<n; i++) {
+        auto tw=wrap_angle(t[i]);
+        auto rad=calc_radius(tw);
+        auto &r=rad.r;
+        auto &r1=rad.r1;
+        auto c=cos(tw);
+        auto s=sin(tw);
+        out.Px[i]=r*c;
+        out.Py[i]=r*s;
+        out.Tx[i]=r1*c-r*s;
+        out.Ty[i]=r1*s+r*c;
+        out.Nx[i]=-out.Ty[i];
+        out.Ny[i]=out.Tx[i];
+    }
+}
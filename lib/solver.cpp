@@ -7,9 +7,25 @@
 
 #include <cmath>
 #include <limits>
+#include <algorithm>
+#include <tuple>
+#include <array>
+#include <numeric>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <fstream>
 #include <yarp/sig/Vector.h>
 #include <yarp/math/Math.h>
-#include <IpIpoptApplication.hpp>
+#include <IpIpoptData.hpp>
+#if (IPOPT_VERSION_MAJOR<3) || ((IPOPT_VERSION_MAJOR==3) && (IPOPT_VERSION_MINOR<14))
+#include <IpIpoptCalculatedQuantities.hpp>
+#include <IpOrigIpoptNLP.hpp>
+#include <IpTNLPAdapter.hpp>
+#endif
+#include "contact.h"
+#include "graspmap.h"
 #include "solver.h"
 
 using namespace std;
@@ -17,17 +33,363 @@ using namespace yarp::sig;
 using namespace yarp::math;
 using namespace problem_ns;
 
+namespace {
+
+// number of variables per contact <t,fn,ft>
+constexpr Ipopt::Index num_vars=3;
+
+// Newton's law (3 rows) followed by two friction rows per contact
+constexpr Ipopt::Index num_newton=3;
+constexpr Ipopt::Index num_friction=2;
+
+// tolerance on the constraints, shared by Ipopt and the tracking
+// of the feasible iterates
+constexpr double constr_viol_tol=1e-3;
+
+// initialization of cold starts, set up by make_application() and
+// restored after each warm start
+constexpr const char *cold_start_init_point="no";
+constexpr double cold_mu_init=.1;
+
+// a small barrier parameter prevents the first iterations of warm
+// starts from moving far away from the retained solution
+constexpr double warm_mu_init=1e-6;
+
+/***************************************************/
+inline Force get_force(const Ipopt::Number *x, const Ipopt::Index i)
+{
+    return Force{x[num_vars*i],x[num_vars*i+1],x[num_vars*i+2]};
+}
+
+/***************************************************/
+class Probe
+{
+    SolveStats::Counter &counter;
+    chrono::steady_clock::time_point start;
+
+public:
+    /***************************************************/
+    explicit Probe(SolveStats::Counter &counter_) : counter(counter_),
+        start(chrono::steady_clock::now()) { }
+
+    /***************************************************/
+    ~Probe()
+    {
+        counter.calls++;
+        counter.time+=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    }
+};
+
+/***************************************************/
+void measure(const Problem& problem, const vector<Force>& forces,
+             SolveStats& stats)
+{
+    // objective and largest violation among Newton's law and friction cones
+    Wrench wrench;
+    problem.eval_wrench(forces.data(),forces.size(),wrench,false);
+    stats.objective=0.;
+    stats.constr_viol=std::max(std::max(fabs(wrench.F.x),fabs(wrench.F.y)),fabs(wrench.T));
+    auto friction=problem.get_friction();
+    for (auto &f:forces) {
+        stats.objective+=f.fn*f.fn+f.ft*f.ft;
+        stats.constr_viol=std::max(stats.constr_viol,fabs(f.ft)-friction*f.fn);
+        stats.constr_viol=std::max(stats.constr_viol,-f.fn);
+    }
+}
+
+/***************************************************/
+template<size_t N>
+WrenchJet<N> eval_jet(const Problem& problem, const ArcLength *arc, const double t)
+{
+    if (arc==nullptr) {
+        return problem.eval_wrench_jet<N>(t);
+    }
+
+    // t is the arc length normalized by the perimeter
+    auto length=arc->get_length();
+    auto jet=arc->eval_wrench_jet<N>(problem,length*t);
+    for (size_t j=0; j<3; j++) {
+        auto scale=1.;
+        for (size_t k=1; k<=N; k++) {
+            scale*=length;
+            jet.normal[j].c[k]*=scale;
+            jet.tangential[j].c[k]*=scale;
+        }
+    }
+    return jet;
+}
+
+/***************************************************/
+template<size_t N>
+void eval_contacts(const Problem& problem, const ArcLength *arc,
+                   const vector<Force>& forces, Wrench& wrench,
+                   vector<Vec2>& d2F, vector<double>& d2T)
+{
+    // one pass over the contacts yields the wrench along with its first
+    // and, for N=2, second derivatives wrt (t,t), (fn,t), (ft,t);
+    // with an arc-length table, t stands for the normalized arc length
+    auto K=forces.size();
+    const auto &wrench0=problem.get_F_wrench();
+    wrench.F=wrench0.F;
+    wrench.T=wrench0.T;
+    wrench.dF.resize(3*K);
+    wrench.dT.resize(3*K);
+    d2F.resize(3*K);
+    d2T.resize(3*K);
+    for (size_t i=0; i<K; i++) {
+        auto &f=forces[i];
+        auto jet=eval_jet<N>(problem,arc,f.t);
+
+        // components <Fx,Fy,T> and their derivatives
+        double w[3], dw[3][3], d2w[3][3];
+        for (size_t j=0; j<3; j++) {
+            auto wj=f.fn*jet.normal[j]+f.ft*jet.tangential[j];
+            w[j]=wj.value();
+            dw[j][0]=wj.derivative(1);
+            dw[j][1]=jet.normal[j].value();
+            dw[j][2]=jet.tangential[j].value();
+            if (N>1) {
+                d2w[j][0]=wj.derivative(2);
+                d2w[j][1]=jet.normal[j].derivative(1);
+                d2w[j][2]=jet.tangential[j].derivative(1);
+            } else {
+                d2w[j][0]=d2w[j][1]=d2w[j][2]=0.;
+            }
+        }
+
+        wrench.F+=Vec2(w[0],w[1]);
+        wrench.T+=w[2];
+        for (size_t k=0; k<3; k++) {
+            wrench.dF[3*i+k]=Vec2(dw[0][k],dw[1][k]);
+            wrench.dT[3*i+k]=dw[2][k];
+            d2F[3*i+k]=Vec2(d2w[0][k],d2w[1][k]);
+            d2T[3*i+k]=d2w[2][k];
+        }
+    }
+}
+
+/***************************************************/
+double score_seed(const Problem& problem, vector<Force>& seed)
+{
+    // residual of the balance achievable with nonnegative normal forces only
+    const auto &COM=problem.eval_COM();
+    const auto &wrench0=problem.get_F_wrench();
+    double w0[3]={wrench0.F.x,wrench0.F.y,wrench0.T};
+
+    auto K=seed.size();
+    vector<array<double,3>> a(K);
+    for (size_t i=0; i<K; i++) {
+        auto frame=problem.eval_frame(seed[i].t);
+        a[i]={frame.N.x,frame.N.y,cross(frame.P-COM,frame.N)};
+    }
+
+    auto dot3=[](const double *u, const double *v) { return u[0]*v[0]+u[1]*v[1]+u[2]*v[2]; };
+
+    // the optimum of the 3-row NNLS has at most 3 active contacts: candidates
+    // are the least-squares solutions over those sets that turn out nonnegative
+    auto best=sqrt(dot3(w0,w0));
+    for (auto &s:seed) {
+        s.fn=0.;
+    }
+    for (size_t mask=1; mask<(size_t(1)<<K); mask++) {
+        size_t act[3], n=0;
+        auto too_many=false;
+        for (size_t i=0; i<K; i++) {
+            if (mask&(size_t(1)<<i)) {
+                if (n==3) {
+                    too_many=true;
+                    break;
+                }
+                act[n++]=i;
+            }
+        }
+        if (too_many) {
+            continue;
+        }
+
+        // normal equations solved by Gaussian elimination
+        double M[3][4];
+        for (size_t r=0; r<n; r++) {
+            for (size_t c=0; c<n; c++) {
+                M[r][c]=dot3(a[act[r]].data(),a[act[c]].data());
+            }
+            M[r][n]=-dot3(a[act[r]].data(),w0);
+        }
+        auto singular=false;
+        for (size_t c=0; (c<n) && !singular; c++) {
+            auto p=c;
+            for (size_t r=c+1; r<n; r++) {
+                if (fabs(M[r][c])>fabs(M[p][c])) {
+                    p=r;
+                }
+            }
+            if (fabs(M[p][c])<1e-12) {
+                singular=true;
+                break;
+            }
+            swap(M[c],M[p]);
+            for (size_t r=0; r<n; r++) {
+                if (r!=c) {
+                    auto k=M[r][c]/M[c][c];
+                    for (size_t j=c; j<=n; j++) {
+                        M[r][j]-=k*M[c][j];
+                    }
+                }
+            }
+        }
+        if (singular) {
+            continue;
+        }
+
+        double fn[3];
+        auto feasible=true;
+        for (size_t r=0; r<n; r++) {
+            fn[r]=M[r][n]/M[r][r];
+            feasible&=(fn[r]>=0.);
+        }
+        if (!feasible) {
+            continue;
+        }
+
+        double res[3]={w0[0],w0[1],w0[2]};
+        for (size_t r=0; r<n; r++) {
+            for (size_t k=0; k<3; k++) {
+                res[k]+=fn[r]*a[act[r]][k];
+            }
+        }
+        auto residual=sqrt(dot3(res,res));
+        if (residual<best) {
+            best=residual;
+            for (auto &s:seed) {
+                s.fn=0.;
+            }
+            for (size_t r=0; r<n; r++) {
+                seed[act[r]].fn=fn[r];
+            }
+        }
+    }
+    return best;
+}
+
+}
+
+/***************************************************/
+void Grasp::update(const Ipopt::Number *x, const bool new_x, const int required)
+{
+    // -2: nothing cached, -1: forces only, 1 or 2: wrench derivatives
+    if (new_x) {
+        cached_order=-2;
+    }
+    if (cached_order<-1) {
+        for (Ipopt::Index i=0; i<num_contacts; i++) {
+            forces[i]=get_force(x,i);
+        }
+        cached_order=-1;
+    }
+    if (required<0) {
+        return;
+    }
+    if (cached_order>=required) {
+        stats.cache_hits++;
+        return;
+    }
+
+    // the geometry is evaluated once per iterate, directly at the
+    // order required by the Hessian mode
+    if (std::max(order,required)>1) {
+        eval_contacts<2>(*problem,arc.get(),forces,wrench,d2F,d2T);
+        cached_order=2;
+    } else {
+        eval_contacts<1>(*problem,arc.get(),forces,wrench,d2F,d2T);
+        cached_order=1;
+    }
+    stats.geometry_evals+=num_contacts;
+}
+
+/***************************************************/
+Force Grasp::to_force(const Force &f) const
+{
+    auto g=f;
+    if (arc) {
+        // back to the non-unit frame at t
+        g.t=arc->eval_angle(arc->get_length()*f.t);
+        auto dP=problem->eval_frame(g.t).dP;
+        auto speed=hypot(dP.x,dP.y);
+        g.fn/=speed;
+        g.ft/=speed;
+    }
+    g.t=Problem::wrap_angle(g.t);
+    return g;
+}
+
+/***************************************************/
+bool Grasp::get_iterate(const Ipopt::IpoptData *ip_data,
+                        Ipopt::IpoptCalculatedQuantities *ip_cq,
+                        Ipopt::Number *x) const
+{
+    if ((ip_data==nullptr) || (ip_cq==nullptr)) {
+        return false;
+    }
+#if (IPOPT_VERSION_MAJOR>3) || ((IPOPT_VERSION_MAJOR==3) && (IPOPT_VERSION_MINOR>=14))
+    return get_curr_iterate(ip_data,ip_cq,false,num_vars*num_contacts,x,
+                            nullptr,nullptr,0,nullptr,nullptr);
+#else
+    // the iterate is stored in the internal representation of the
+    // adapter, which maps it back to the variables of the NLP
+    auto orig=dynamic_cast<Ipopt::OrigIpoptNLP*>(Ipopt::GetRawPtr(ip_cq->GetIpoptNLP()));
+    if (orig==nullptr) {
+        return false;
+    }
+    auto adapter=dynamic_cast<Ipopt::TNLPAdapter*>(Ipopt::GetRawPtr(orig->nlp()));
+    if (adapter==nullptr) {
+        return false;
+    }
+    adapter->ResortX(*ip_data->curr()->x(),x);
+    return true;
+#endif
+}
+
+/***************************************************/
+void Grasp::track_best(const Ipopt::Number *x)
+{
+    // the iterate is evaluated aside, since the cache must keep holding
+    // the last point evaluated, which might be a rejected trial point
+    auto friction=problem->get_friction();
+    double viol=0., effort=0.;
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        auto f=get_force(x,i);
+        viol=std::max(viol,std::max(fabs(f.ft)-friction*f.fn,-f.fn));
+        effort+=f.fn*f.fn+f.ft*f.ft;
+        candidate[i]=to_force(f);
+    }
+    if (!best.empty() && (effort>=best_effort)) {
+        return;
+    }
+
+    Wrench w;
+    problem->eval_wrench(candidate.data(),candidate.size(),w,false);
+    viol=std::max(viol,std::max(std::max(fabs(w.F.x),fabs(w.F.y)),fabs(w.T)));
+    if (viol<=constr_viol_tol) {
+        best=candidate;
+        best_effort=effort;
+    }
+}
+
 /***************************************************/
 bool Grasp::get_nlp_info(Ipopt::Index &n, Ipopt::Index &m,
                          Ipopt::Index &nnz_jac_g,
                          Ipopt::Index &nnz_h_lag,
                          IndexStyleEnum &index_style)
 {
-    // FIX THE CODE
-    n=0;
-    m=0;
-    nnz_jac_g=0;
-    nnz_h_lag=0;
+    n=num_vars*num_contacts;
+    m=num_newton+num_friction*num_contacts;
+
+    // Newton's rows depend on the 3 variables of each contact, friction
+    // rows on <fn,ft> of their own contact only: nnz grows linearly with K
+    nnz_jac_g=num_newton*n+num_friction*2*num_contacts;
+
+    // per contact lower triangle: (t,t), (fn,t), (ft,t), (fn,fn), (ft,ft)
+    nnz_h_lag=5*num_contacts;
     index_style=TNLP::C_STYLE;
     return true;
 }
@@ -37,7 +399,33 @@ bool Grasp::get_bounds_info(Ipopt::Index n, Ipopt::Number *x_l,
                             Ipopt::Number *x_u, Ipopt::Index m,
                             Ipopt::Number *g_l, Ipopt::Number *g_u)
 {
-    // FILL IN THE CODE
+    auto inf=numeric_limits<double>::max();
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        // t
+        x_l[num_vars*i]=-inf;
+        x_u[num_vars*i]=inf;
+
+        // fn: inward forces only
+        x_l[num_vars*i+1]=0.;
+        x_u[num_vars*i+1]=inf;
+
+        // ft
+        x_l[num_vars*i+2]=-inf;
+        x_u[num_vars*i+2]=inf;
+    }
+
+    for (Ipopt::Index j=0; j<num_newton; j++) {
+        g_l[j]=g_u[j]=0.;
+    }
+
+    // friction cone: ft-friction*fn<=0 and ft+friction*fn>=0
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        auto j=num_newton+num_friction*i;
+        g_l[j]=-inf;
+        g_u[j]=0.;
+        g_l[j+1]=0.;
+        g_u[j+1]=inf;
+    }
     return true;
 }
 
@@ -47,8 +435,54 @@ bool Grasp::get_starting_point(Ipopt::Index n, bool init_x,
                                Ipopt::Number *z_L, Ipopt::Number *z_U,
                                Ipopt::Index m, bool init_lambda,
                                Ipopt::Number *lambda)
-{                                        
-    // FILL IN THE CODE
+{
+    cached_order=-2;
+    best.clear();
+    // shapes the table cannot follow accurately keep the angles
+    if ((parametrization==Parametrization::arc_length) && !arc &&
+        (ArcLength::calc_resolution(*problem)>0)) {
+        arc.reset(new ArcLength(*problem));
+    }
+
+    // the retained solution is expressed in the variables of the NLP
+    // already, which do not depend on the load
+    if (warm_start && has_warm_start()) {
+        if (init_x) {
+            copy(begin(warm_x),end(warm_x),x);
+        }
+        if (init_z) {
+            copy(begin(warm_z_L),end(warm_z_L),z_L);
+            copy(begin(warm_z_U),end(warm_z_U),z_U);
+        }
+        if (init_lambda) {
+            copy(begin(warm_lambda),end(warm_lambda),lambda);
+        }
+        return true;
+    }
+
+    // contacts evenly spread around F, sharing the same normal force,
+    // unless a seed is given
+    auto start=seed;
+    if (start.size()!=(size_t)num_contacts) {
+        const auto &F=problem->get_F();
+        start.resize(num_contacts);
+        for (Ipopt::Index i=0; i<num_contacts; i++) {
+            start[i]=Force{Problem::wrap_angle(F.t+2.*M_PI*(i+1)/(num_contacts+1)),F.fn,0.};
+        }
+    }
+
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        auto f=start[i];
+        if (arc) {
+            // same physical force, expressed along the unit frame
+            auto dP=problem->eval_frame(f.t).dP;
+            auto speed=hypot(dP.x,dP.y);
+            f=Force{arc->eval_length(f.t)/arc->get_length(),f.fn*speed,f.ft*speed};
+        }
+        x[num_vars*i]=f.t;
+        x[num_vars*i+1]=f.fn;
+        x[num_vars*i+2]=f.ft;
+    }
     return true;
 }
 
@@ -56,7 +490,12 @@ bool Grasp::get_starting_point(Ipopt::Index n, bool init_x,
 bool Grasp::eval_f(Ipopt::Index n, const Ipopt::Number *x,
                    bool new_x, Ipopt::Number &obj_value)
 {
-    // FILL IN THE CODE
+    Probe probe(stats.callbacks[SolveStats::eval_f]);
+    update(x,new_x,-1);
+    obj_value=0.;
+    for (auto &f:forces) {
+        obj_value+=f.fn*f.fn+f.ft*f.ft;
+    }
     assert(!isnan(obj_value));
     return true;
 }
@@ -65,7 +504,14 @@ bool Grasp::eval_f(Ipopt::Index n, const Ipopt::Number *x,
 bool Grasp::eval_grad_f(Ipopt::Index n, const Ipopt::Number *x,
                         bool new_x, Ipopt::Number *grad_f)
 {
-    // FILL IN THE CODE
+    Probe probe(stats.callbacks[SolveStats::eval_grad_f]);
+    update(x,new_x,-1);
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        auto &f=forces[i];
+        grad_f[num_vars*i]=0.;
+        grad_f[num_vars*i+1]=2.*f.fn;
+        grad_f[num_vars*i+2]=2.*f.ft;
+    }
     for (Ipopt::Index i=0; i<n; i++) {
         assert(!isnan(grad_f[i]));
     }
@@ -76,7 +522,19 @@ bool Grasp::eval_grad_f(Ipopt::Index n, const Ipopt::Number *x,
 bool Grasp::eval_g(Ipopt::Index n, const Ipopt::Number *x,
                    bool new_x, Ipopt::Index m, Ipopt::Number *g)
 {
-    // FILL IN THE CODE
+    Probe probe(stats.callbacks[SolveStats::eval_g]);
+    update(x,new_x,0);
+    g[0]=wrench.F.x;
+    g[1]=wrench.F.y;
+    g[2]=wrench.T;
+
+    auto friction=problem->get_friction();
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        auto j=num_newton+num_friction*i;
+        g[j]=forces[i].ft-friction*forces[i].fn;
+        g[j+1]=forces[i].ft+friction*forces[i].fn;
+    }
+
     for (Ipopt::Index i=0; i<m; i++) {
         assert(!isnan(g[i]));
     }
@@ -89,13 +547,115 @@ bool Grasp::eval_jac_g(Ipopt::Index n, const Ipopt::Number *x,
                        Ipopt::Index *iRow, Ipopt::Index *jCol,
                        Ipopt::Number *values)
 {
-    // FILL IN THE CODE
+    Probe probe(stats.callbacks[SolveStats::eval_jac_g]);
     if (values==nullptr) {
+        Ipopt::Index idx=0;
+        for (Ipopt::Index j=0; j<num_newton; j++) {
+            for (Ipopt::Index k=0; k<n; k++) {
+                iRow[idx]=j;
+                jCol[idx]=k;
+                idx++;
+            }
+        }
+        for (Ipopt::Index i=0; i<num_contacts; i++) {
+            for (Ipopt::Index j=0; j<num_friction; j++) {
+                for (Ipopt::Index k=1; k<num_vars; k++) {
+                    iRow[idx]=num_newton+num_friction*i+j;
+                    jCol[idx]=num_vars*i+k;
+                    idx++;
+                }
+            }
+        }
+        assert(idx==nele_jac);
     } else {
+        // d(Ftot)/d<t,fn,ft> and d(Ttot)/d<t,fn,ft>
+        update(x,new_x,1);
+        for (Ipopt::Index k=0; k<n; k++) {
+            values[k]=wrench.dF[k].x;
+            values[n+k]=wrench.dF[k].y;
+            values[2*n+k]=wrench.dT[k];
+        }
+
+        auto friction=problem->get_friction();
+        for (Ipopt::Index i=0; i<num_contacts; i++) {
+            auto idx=num_newton*n+num_friction*2*i;
+            values[idx]=-friction;
+            values[idx+1]=1.;
+            values[idx+2]=friction;
+            values[idx+3]=1.;
+        }
+
+        for (Ipopt::Index i=0; i<nele_jac; i++) {
+            assert(!isnan(values[i]));
+        }
     }
     return true;
 }
 
+/***************************************************/
+bool Grasp::eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
+                   Ipopt::Number obj_factor, Ipopt::Index m, const Ipopt::Number *lambda,
+                   bool new_lambda, Ipopt::Index nele_hess, Ipopt::Index *iRow,
+                   Ipopt::Index *jCol, Ipopt::Number *values)
+{
+    Probe probe(stats.callbacks[SolveStats::eval_h]);
+    // contacts are decoupled, hence the Hessian is block diagonal
+    // and the friction rows are linear, thus not contributing
+    if (values==nullptr) {
+        for (Ipopt::Index i=0; i<num_contacts; i++) {
+            auto t=num_vars*i, fn=t+1, ft=t+2;
+            Ipopt::Index rows[5]={t,fn,ft,fn,ft};
+            Ipopt::Index cols[5]={t,t,t,fn,ft};
+            for (Ipopt::Index k=0; k<5; k++) {
+                iRow[5*i+k]=rows[k];
+                jCol[5*i+k]=cols[k];
+            }
+        }
+    } else {
+        update(x,new_x,2);
+        for (Ipopt::Index i=0; i<num_contacts; i++) {
+            // second derivatives of <Ftot,Ttot> wrt (t,t), (fn,t), (ft,t)
+            for (Ipopt::Index k=0; k<3; k++) {
+                const auto &d2Fk=d2F[3*i+k];
+                values[5*i+k]=lambda[0]*d2Fk.x+lambda[1]*d2Fk.y+lambda[2]*d2T[3*i+k];
+            }
+
+            // objective contributes on (fn,fn) and (ft,ft)
+            values[5*i+3]=2.*obj_factor;
+            values[5*i+4]=2.*obj_factor;
+        }
+
+        for (Ipopt::Index i=0; i<nele_hess; i++) {
+            assert(!isnan(values[i]));
+        }
+    }
+    return true;
+}
+
+/***************************************************/
+bool Grasp::intermediate_callback(Ipopt::AlgorithmMode mode, Ipopt::Index iter,
+                                  Ipopt::Number obj_value, Ipopt::Number inf_pr,
+                                  Ipopt::Number inf_du, Ipopt::Number mu,
+                                  Ipopt::Number d_norm, Ipopt::Number regularization_size,
+                                  Ipopt::Number alpha_du, Ipopt::Number alpha_pr,
+                                  Ipopt::Index ls_trials, const Ipopt::IpoptData *ip_data,
+                                  Ipopt::IpoptCalculatedQuantities *ip_cq)
+{
+    // iterates of the restoration phase solve another problem
+    auto bounded=(deadline!=chrono::steady_clock::time_point::max());
+    if (bounded && (mode==Ipopt::RegularMode)) {
+        if (get_iterate(ip_data,ip_cq,iterate.data())) {
+            track_best(iterate.data());
+        }
+    }
+
+    // returning false makes Ipopt stop with User_Requested_Stop
+    if ((cancel!=nullptr) && cancel->load(memory_order_relaxed)) {
+        return false;
+    }
+    return (!bounded || (chrono::steady_clock::now()<deadline));
+}
+
 /***************************************************/
 void Grasp::finalize_solution(Ipopt::SolverReturn status,
                               Ipopt::Index n, const Ipopt::Number *x,
@@ -105,31 +665,506 @@ void Grasp::finalize_solution(Ipopt::SolverReturn status,
                               Ipopt::Number obj_value, const Ipopt::IpoptData *ip_data,
                               Ipopt::IpoptCalculatedQuantities *ip_cq)
 {
-    // FIX THE CODE
-    result[0].t=0.;
-    result[0].fn=0.;
-    result[0].ft=0.;
-    result[1].t=0.;
-    result[1].fn=0.;
-    result[1].ft=0.;
+    for (Ipopt::Index i=0; i<num_contacts; i++) {
+        result[i]=to_force(get_force(x,i));
+    }
+    stats.iterations=(ip_data!=nullptr?ip_data->iter_count():0);
+    stats.status=status;
+    if ((status==Ipopt::SUCCESS) || (status==Ipopt::STOP_AT_ACCEPTABLE_POINT)) {
+        stats.quality=SolveQuality::converged;
+        warm_x.assign(x,x+n);
+        warm_z_L.assign(z_L,z_L+n);
+        warm_z_U.assign(z_U,z_U+n);
+        warm_lambda.assign(lambda,lambda+m);
+        warm_shape=problem->get_shape();
+        warm_widths=problem->get_widths();
+    } else {
+        warm_x.clear();
+        if (!best.empty()) {
+            result=best;
+            stats.quality=SolveQuality::feasible;
+        } else {
+            stats.quality=SolveQuality::fallback;
+        }
+    }
+    measure(*problem,result,stats);
 }
 
 /***************************************************/
-vector<Force> Solver::solve(const Problem& problem,
-                            const bool verbose)
+const char* SolveStats::get_callback_name(const Callback c)
 {
+    switch (c) {
+    case eval_f:
+        return "eval_f";
+    case eval_grad_f:
+        return "eval_grad_f";
+    case eval_g:
+        return "eval_g";
+    case eval_jac_g:
+        return "eval_jac_g";
+    case eval_h:
+        return "eval_h";
+    default:
+        return "unknown";
+    }
+}
+
+/***************************************************/
+string SolveStats::csv_header()
+{
+    ostringstream ss;
+    ss << "status,quality,iterations,objective,constr_viol";
+    for (int c=0; c<num_callbacks; c++) {
+        auto name=get_callback_name((Callback)c);
+        ss << "," << name << "_calls," << name << "_time";
+    }
+    ss << ",geometry_evals,cache_hits,wall_time";
+    return ss.str();
+}
+
+/***************************************************/
+string SolveStats::to_csv() const
+{
+    ostringstream ss;
+    ss.precision(9);
+    ss << (int)status << "," << (int)quality << "," << iterations << ","
+       << objective << "," << constr_viol;
+    for (auto &c:callbacks) {
+        ss << "," << c.calls << "," << c.time;
+    }
+    ss << "," << geometry_evals << "," << cache_hits << "," << wall_time;
+    return ss.str();
+}
+
+/***************************************************/
+string SolveStats::to_json() const
+{
+    ostringstream ss;
+    ss.precision(9);
+    ss << "{\"status\":" << (int)status << ",\"quality\":" << (int)quality
+       << ",\"iterations\":" << iterations
+       << ",\"objective\":" << objective << ",\"constr_viol\":" << constr_viol
+       << ",\"callbacks\":{";
+    for (int c=0; c<num_callbacks; c++) {
+        ss << (c>0?",":"") << "\"" << get_callback_name((Callback)c) << "\":{\"calls\":"
+           << callbacks[c].calls << ",\"time\":" << callbacks[c].time << "}";
+    }
+    ss << "},\"geometry_evals\":" << geometry_evals << ",\"cache_hits\":" << cache_hits
+       << ",\"wall_time\":" << wall_time << "}";
+    return ss.str();
+}
+
+/***************************************************/
+bool SolveStats::append(const string& filename, const bool json) const
+{
+    auto empty=true;
+    {
+        ifstream fin(filename,ios::binary|ios::ate);
+        empty=(!fin.is_open() || (fin.tellg()<=0));
+    }
+
+    ofstream fout(filename,ios::app);
+    if (!fout.is_open()) {
+        return false;
+    }
+    if (!json && empty) {
+        fout << csv_header() << endl;
+    }
+    fout << (json?to_json():to_csv()) << endl;
+    return fout.good();
+}
+
+/***************************************************/
+Ipopt::SmartPtr<Ipopt::IpoptApplication> Solver::make_application(const bool verbose,
+                                                                  const HessianMode hessian)
+{
+    auto exact=(hessian==HessianMode::exact);
     Ipopt::SmartPtr<Ipopt::IpoptApplication> app=new Ipopt::IpoptApplication;
     app->Options()->SetNumericValue("tol",1e-6);
-    app->Options()->SetNumericValue("constr_viol_tol",1e-3);
+    app->Options()->SetNumericValue("constr_viol_tol",constr_viol_tol);
     app->Options()->SetIntegerValue("acceptable_iter",0);
     app->Options()->SetStringValue("mu_strategy","monotone");
     app->Options()->SetIntegerValue("max_iter",1000);
-    app->Options()->SetStringValue("hessian_approximation","limited-memory");
+    app->Options()->SetStringValue("hessian_approximation",exact?"exact":"limited-memory");
     app->Options()->SetStringValue("derivative_test",verbose?"first-order":"none");
     app->Options()->SetIntegerValue("print_level",verbose?5:0);
+    app->Options()->SetStringValue("warm_start_init_point",cold_start_init_point);
+    app->Options()->SetNumericValue("mu_init",cold_mu_init);
+
+    // used only when warm starting: keep the retained solution
+    // in place rather than pushing it into the interior
+    app->Options()->SetNumericValue("warm_start_bound_push",1e-9);
+    app->Options()->SetNumericValue("warm_start_slack_bound_push",1e-9);
+    app->Options()->SetNumericValue("warm_start_mult_bound_push",1e-9);
     app->Initialize();
+    return app;
+}
+
+/***************************************************/
+Solver::Solver(const bool verbose, const HessianMode hessian,
+               const size_t num_contacts, const Parametrization parametrization) :
+    app(make_application(verbose,hessian)), hessian(hessian),
+    num_contacts(num_contacts), parametrization(parametrization)
+{
+    assert(num_contacts>0);
+}
 
-    Ipopt::SmartPtr<Grasp> nlp=new Grasp(problem);
+/***************************************************/
+vector<Force> Solver::compute(const Problem& problem)
+{
+    return compute(problem,vector<Force>());
+}
+
+/***************************************************/
+vector<Force> Solver::optimize(const Problem& problem, const vector<Force>& seed,
+                               const atomic<bool> *cancel,
+                               const chrono::steady_clock::time_point &deadline)
+{
+    // the NLP is created once and then rebound to the new problem;
+    // only track() keeps what it retains in use
+    tracked=nullptr;
+    if (Ipopt::IsNull(nlp)) {
+        nlp=new Grasp(problem,num_contacts,hessian,parametrization);
+    } else {
+        nlp->bind(problem);
+    }
+    auto start=chrono::steady_clock::now();
+    if (seed.empty() && (map_resolution>0) && (num_contacts==2)) {
+        nlp->set_seed(GraspMap(problem,map_resolution).get_seed());
+    } else {
+        nlp->set_seed(seed);
+    }
+    nlp->set_cancel(cancel);
+    nlp->set_deadline(deadline);
+    nlp->reset_stats();
     app->OptimizeTNLP(Ipopt::GetRawPtr(nlp));
+    stats=nlp->get_stats();
+    stats.wall_time=chrono::duration<double>(chrono::steady_clock::now()-start).count();
     return nlp->get_result();
 }
+
+/***************************************************/
+void Solver::set_map_seeding(const size_t resolution)
+{
+    map_resolution=resolution;
+}
+
+/***************************************************/
+vector<Force> Solver::compute(const Problem& problem,
+                              const vector<Force>& seed,
+                              const atomic<bool> *cancel)
+{
+    // circles are solved in closed form, with no need for Ipopt, unless
+    // a starting point is imposed or the solve is cancelled already
+    auto start=chrono::steady_clock::now();
+    vector<Force> forces;
+    if (seed.empty() && (num_contacts==2) &&
+        ((cancel==nullptr) || !cancel->load(memory_order_relaxed)) &&
+        ContactSolver::solve_circle(problem,forces)) {
+        stats=SolveStats();
+        stats.status=Ipopt::SUCCESS;
+        stats.quality=SolveQuality::converged;
+        measure(problem,forces,stats);
+        stats.wall_time=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        return forces;
+    }
+    return optimize(problem,seed,cancel,chrono::steady_clock::time_point::max());
+}
+
+/***************************************************/
+vector<Force> Solver::compute_within(const Problem& problem, const double budget,
+                                     const vector<Force>& seed)
+{
+    auto start=chrono::steady_clock::now();
+    vector<Force> forces;
+    if ((num_contacts==2) && ContactSolver::solve_circle(problem,forces)) {
+        stats=SolveStats();
+        stats.status=Ipopt::SUCCESS;
+        stats.quality=SolveQuality::converged;
+        measure(problem,forces,stats);
+        stats.wall_time=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+        return forces;
+    }
+
+    auto deadline=start+chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(budget));
+    forces=optimize(problem,seed,nullptr,deadline);
+    if ((stats.quality==SolveQuality::fallback) && (num_contacts==2)) {
+        // a coarse grid keeps the heuristic within a fraction of a millisecond
+        forces=ContactSolver(12,8).solve(problem);
+        measure(problem,forces,stats);
+    }
+    stats.wall_time=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    return forces;
+}
+
+/***************************************************/
+vector<Force> Solver::track(const Problem& problem)
+{
+    if ((num_contacts==2) && problem.is_circle()) {
+        return compute(problem);
+    }
+
+    // the retained solution is reused only if the previous solve
+    // was issued by track() on the same problem
+    auto warm=((tracked==&problem) && !Ipopt::IsNull(nlp) && nlp->has_warm_start());
+    if (warm) {
+        nlp->set_warm_start(true);
+        app->Options()->SetStringValue("warm_start_init_point","yes");
+        app->Options()->SetNumericValue("mu_init",warm_mu_init);
+    }
+    auto forces=optimize(problem,vector<Force>(),nullptr,chrono::steady_clock::time_point::max());
+    if (warm) {
+        nlp->set_warm_start(false);
+        app->Options()->SetStringValue("warm_start_init_point",cold_start_init_point);
+        app->Options()->SetNumericValue("mu_init",cold_mu_init);
+    }
+    tracked=&problem;
+    return forces;
+}
+
+/***************************************************/
+vector<Force> Solver::track(Problem& problem, const double friction, const Force& F)
+{
+    if (!problem.configure_load(friction,F)) {
+        return vector<Force>();
+    }
+    return track(static_cast<const Problem&>(problem));
+}
+
+/***************************************************/
+int Solver::get_iterations() const
+{
+    return stats.iterations;
+}
+
+/***************************************************/
+Ipopt::SolverReturn Solver::get_status() const
+{
+    return stats.status;
+}
+
+/***************************************************/
+const SolveStats& Solver::get_stats() const
+{
+    return stats;
+}
+
+/***************************************************/
+vector<Force> Solver::solve(const Problem& problem,
+                            const bool verbose,
+                            const HessianMode hessian,
+                            const size_t num_contacts,
+                            SolveStats *stats)
+{
+    Solver solver(verbose,hessian,num_contacts);
+    auto forces=solver.compute(problem);
+    if (stats!=nullptr) {
+        *stats=solver.get_stats();
+    }
+    return forces;
+}
+
+/***************************************************/
+BatchSolver::BatchSolver(const size_t num_workers, const HessianMode hessian,
+                         const size_t num_contacts) :
+    pool(num_workers), num_contacts(num_contacts)
+{
+    for (size_t i=0; i<pool.size(); i++) {
+        solvers.emplace_back(new Solver(false,hessian,num_contacts));
+    }
+}
+
+/***************************************************/
+size_t BatchSolver::get_num_workers() const
+{
+    return pool.size();
+}
+
+/***************************************************/
+size_t BatchSolver::get_num_contacts() const
+{
+    return num_contacts;
+}
+
+/***************************************************/
+void BatchSolver::set_map_seeding(const size_t resolution)
+{
+    for (auto &solver:solvers) {
+        solver->set_map_seeding(resolution);
+    }
+}
+
+/***************************************************/
+vector<vector<Force>> BatchSolver::solve_batch(const vector<const Problem*>& problems)
+{
+    vector<vector<Force>> results(problems.size());
+    pool.parallel_for(problems.size(),[&](const size_t worker, const size_t i) {
+        results[i]=solvers[worker]->compute(*problems[i]);
+    });
+    return results;
+}
+
+/***************************************************/
+vector<Force> BatchSolver::solve_multistart(const Problem& problem,
+                                            const MultiStartOptions& options)
+{
+    vector<Force> forces;
+    if ((num_contacts==2) && ContactSolver::solve_circle(problem,forces)) {
+        return forces;
+    }
+
+    // rank the seeds over the grid combinations t1<t2<...<tK
+    vector<pair<double,vector<Force>>> seeds;
+    vector<size_t> idx(num_contacts);
+    iota(begin(idx),end(idx),0);
+    while (num_contacts<=options.grid) {
+        vector<Force> seed(num_contacts);
+        for (size_t k=0; k<num_contacts; k++) {
+            seed[k].t=(2.*M_PI*idx[k])/options.grid;
+        }
+        auto score=score_seed(problem,seed);
+        seeds.emplace_back(score,seed);
+
+        // next combination in lexicographic order
+        auto k=num_contacts;
+        while ((k>0) && (idx[k-1]==options.grid-num_contacts+k-1)) {
+            k--;
+        }
+        if (k==0) {
+            break;
+        }
+        idx[k-1]++;
+        for (auto j=k; j<num_contacts; j++) {
+            idx[j]=idx[j-1]+1;
+        }
+    }
+    auto num_starts=std::min(options.num_starts,seeds.size());
+    partial_sort(begin(seeds),begin(seeds)+num_starts,end(seeds),
+                 [](const pair<double,vector<Force>>& a, const pair<double,vector<Force>>& b) {
+                     return (a.first<b.first);
+                 });
+
+    atomic<bool> cancel{false};
+    mutex mtx;
+    vector<Force> best;
+    auto best_residual=numeric_limits<double>::max();
+
+    pool.parallel_for(num_starts,[&](const size_t worker, const size_t i) {
+        if (cancel.load(memory_order_relaxed)) {
+            return;
+        }
+
+        auto forces=solvers[worker]->compute(problem,seeds[i].second,&cancel);
+        auto F_T=problem.compute_newton_law(forces);
+        auto F=hypot(F_T.first[0],F_T.first[1]);
+        auto T=fabs(F_T.second);
+        auto accepted=(F<options.F_eps) && (T<options.T_eps) &&
+                      problem.check_no_slippage(forces);
+
+        lock_guard<mutex> lck(mtx);
+        if (cancel.load(memory_order_relaxed)) {
+            return;
+        }
+        if (accepted) {
+            best=forces;
+            cancel.store(true);
+        } else if (problem.check_no_slippage(forces) && (F+T<best_residual)) {
+            best=forces;
+            best_residual=F+T;
+        }
+    });
+
+    return (best.empty()?solvers.front()->compute(problem):best);
+}
+
+/***************************************************/
+void BatchSolver::parallel_for(const size_t n,
+                               const function<void(Solver&, const size_t)> &fn)
+{
+    pool.parallel_for(n,[&](const size_t worker, const size_t i) {
+        fn(*solvers[worker],i);
+    });
+}
+
+/***************************************************/
+AsyncSolver::AsyncSolver(const size_t num_workers, const HessianMode hessian,
+                         const size_t num_contacts)
+{
+    assert(num_workers>0);
+    for (size_t i=0; i<num_workers; i++) {
+        solvers.emplace_back(new Solver(false,hessian,num_contacts));
+    }
+    for (size_t i=0; i<num_workers; i++) {
+        workers.emplace_back(&AsyncSolver::loop,this,i);
+    }
+}
+
+/***************************************************/
+AsyncSolver::~AsyncSolver()
+{
+    deque<Request> pending;
+    {
+        lock_guard<mutex> lck(mtx);
+        closing=true;
+        pending.swap(requests);
+    }
+    cv.notify_all();
+    for (auto &r:pending) {
+        AsyncResult result;
+        result.cancelled=true;
+        r.promise.set_value(move(result));
+    }
+    for (auto &w:workers) {
+        w.join();
+    }
+}
+
+/***************************************************/
+size_t AsyncSolver::get_num_workers() const
+{
+    return workers.size();
+}
+
+/***************************************************/
+future<AsyncResult> AsyncSolver::solve_async(const Problem& problem,
+                                             const CancelToken& token,
+                                             const vector<Force>& seed)
+{
+    Request r{problem,seed,token,promise<AsyncResult>()};
+    auto f=r.promise.get_future();
+    {
+        lock_guard<mutex> lck(mtx);
+        requests.push_back(move(r));
+    }
+    cv.notify_one();
+    return f;
+}
+
+/***************************************************/
+void AsyncSolver::loop(const size_t worker)
+{
+    auto &solver=*solvers[worker];
+    while (true) {
+        Request r;
+        {
+            unique_lock<mutex> lck(mtx);
+            cv.wait(lck,[this]() { return (closing || !requests.empty()); });
+            if (closing) {
+                return;
+            }
+            r=move(requests.front());
+            requests.pop_front();
+        }
+
+        // stale requests are dropped before paying for the solve
+        AsyncResult result;
+        if (r.token.is_cancelled()) {
+            result.cancelled=true;
+        } else {
+            result.forces=solver.compute(r.problem,r.seed,r.token.get());
+            result.stats=solver.get_stats();
+            result.cancelled=r.token.is_cancelled();
+        }
+        r.promise.set_value(move(result));
+    }
+}
@@ -5,20 +5,216 @@
 #ifndef SOLVER_H
 #define SOLVER_H
 
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
 #include <IpTNLP.hpp>
+#include <IpIpoptApplication.hpp>
 #include "problem.h"
+#include "arclength.h"
+#include "pool.h"
 
 namespace problem_ns {
 
+/**
+ * Strategy to deal with the Hessian of the Lagrangian.
+ * - exact:          the Hessian is computed analytically.
+ * - limited_memory: the Hessian is approximated with L-BFGS.
+ *
+ * L-BFGS is the default; the exact Hessian is opt-in until the
+ * "hessian" benchmark of bench_2Dgrasp shows it pays off.
+ */
+enum class HessianMode {
+    exact,
+    limited_memory
+};
+
+/**
+ * Variable locating each contact along the perimeter.
+ * - angle:      the polar angle t, with forces expressed along
+ *               the (non-unit) N and T of the frame at t.
+ * - arc_length: the arc length normalized to [0,1) by the perimeter,
+ *               with forces expressed along the unit N and T.
+ * angle is the default; arc_length is opt-in until its iteration
+ * counts are measured against it (see the "parametrization" bench).
+ */
+enum class Parametrization {
+    angle,
+    arc_length
+};
+
+/**
+ * Quality of the forces returned by a solve.
+ * - converged: Ipopt converged.
+ * - feasible:  Ipopt stopped short (e.g. at the deadline) and the
+ *              forces are the best feasible iterate met so far.
+ * - fallback:  no feasible iterate was met; the forces come from
+ *              a cheap heuristic, or are the last iterate if none
+ *              applies, and may violate the constraints.
+ */
+enum class SolveQuality {
+    converged,
+    feasible,
+    fallback
+};
+
+/**
+ * Statistics of a single solve.
+ *
+ * Besides the outcome reported by Ipopt, it gathers the number
+ * of calls and the cumulative time (in seconds) spent within
+ * each evaluation callback of the NLP, as well as the number of
+ * contacts whose geometry got evaluated and the number of callbacks
+ * served by the per-iterate cache.
+ */
+struct SolveStats {
+    /**
+     * Evaluation callbacks of the NLP.
+     */
+    enum Callback {
+        eval_f,
+        eval_grad_f,
+        eval_g,
+        eval_jac_g,
+        eval_h,
+        num_callbacks
+    };
+
+    /**
+     * Calls and cumulative time of a callback.
+     */
+    struct Counter {
+        size_t calls{0};
+        double time{0.};
+    };
+
+    Ipopt::SolverReturn status{Ipopt::UNASSIGNED};
+    SolveQuality quality{SolveQuality::fallback};
+    int iterations{0};
+    double objective{0.};
+    double constr_viol{0.};
+    Counter callbacks[num_callbacks];
+    size_t geometry_evals{0};
+    size_t cache_hits{0};
+    double wall_time{0.};
+
+   /**
+    * Retrieve the name of a callback.
+    * @param c is the callback.
+    * @return the name.
+    */
+    static const char* get_callback_name(const Callback c);
+
+   /**
+    * Retrieve the header of the CSV representation.
+    * @return the comma-separated column names.
+    */
+    static std::string csv_header();
+
+   /**
+    * Format the statistics as a CSV line.
+    * @return the line, with no trailing newline.
+    */
+    std::string to_csv() const;
+
+   /**
+    * Format the statistics as a JSON object on a single line.
+    * @return the line, with no trailing newline.
+    */
+    std::string to_json() const;
+
+   /**
+    * Append the statistics to a file as a CSV or JSON line.
+    * The CSV header is written first when the file is empty.
+    * @param filename is the file to append to.
+    * @param json to select JSON lines in place of CSV.
+    * @return true upon success.
+    */
+    bool append(const std::string& filename, const bool json=false) const;
+};
+
 /**
  * NLP API.
+ *
+ * The unknowns are x=[t1,fn1,ft1,...,tK,fnK,ftK] for K free
+ * contacts (2 by default), the effort sum(fn^2+ft^2) is minimized
+ * subject to Newton's law for linear and rotational motion
+ * (3 equalities) and to the linearized friction cones
+ * |ft|<=friction*fn (2K inequalities).
+ *
+ * With Parametrization::arc_length, each t is replaced by the
+ * normalized arc length u and <fn,ft> become the components of the
+ * force along the unit frame, hence the effort being minimized is the
+ * physical one. The ArcLength table of the problem is built at the
+ * first solve after binding it; seeds and results are converted back
+ * and forth, so that the interface is the same. Shapes whose table
+ * would not meet its accuracy within the largest automatic resolution
+ * (see ArcLength::calc_resolution()) are solved over the angles.
+ *
+ * The primal-dual solution of each converged solve is retained and,
+ * when warm start is enabled, it replaces the starting point (and the
+ * seed) of the next solve, which also initializes the multipliers.
+ *
+ * When a deadline is set, the current iterate is read from Ipopt at
+ * each iteration of the regular mode and, if feasible within the
+ * tolerance on the constraints, tracked aside from the cache; the one
+ * with the least effort is returned if Ipopt does not converge.
+ *
+ * The wrench and its derivatives are cached per iterate: they are
+ * computed once, as soon as a callback receives a new x, up to the
+ * order required by the Hessian mode, and reused by the callbacks
+ * that follow at the same x.
  */
 class Grasp : public Ipopt::TNLP
 {
 protected:
-    const Problem &problem;
+    const Problem *problem;
+    Ipopt::Index num_contacts;
     std::vector<Force> result;
+    std::vector<Force> seed;
+    const std::atomic<bool> *cancel{nullptr};
+    std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+    std::vector<Force> best, candidate;
+    std::vector<Ipopt::Number> iterate;
+    double best_effort{0.};
+    bool warm_start{false};
+    std::vector<double> warm_x, warm_z_L, warm_z_U, warm_lambda;
+    std::vector<double> warm_shape, warm_widths;
+    SolveStats stats;
+
+    // per-iterate cache: the forces, the wrench with its gradient and
+    // the second derivatives wrt (t,t), (fn,t), (ft,t) of each contact
+    Parametrization parametrization;
+    std::unique_ptr<ArcLength> arc;
+    int order;
+    int cached_order{-1};
+    std::vector<Force> forces;
+    Wrench wrench;
+    std::vector<Vec2> d2F;
+    std::vector<double> d2T;
+
+    /***************************************************/
+    void update(const Ipopt::Number *x, const bool new_x, const int required);
+
+    /***************************************************/
+    Force to_force(const Force &f) const;
+
+    /***************************************************/
+    bool get_iterate(const Ipopt::IpoptData *ip_data,
+                     Ipopt::IpoptCalculatedQuantities *ip_cq,
+                     Ipopt::Number *x) const;
+
+    /***************************************************/
+    void track_best(const Ipopt::Number *x);
 
     /***************************************************/
     bool get_nlp_info(Ipopt::Index &n, Ipopt::Index &m,
@@ -60,10 +256,16 @@ protected:
     bool eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x,
                 Ipopt::Number obj_factor, Ipopt::Index m, const Ipopt::Number *lambda,
                 bool new_lambda, Ipopt::Index nele_hess, Ipopt::Index *iRow,
-                Ipopt::Index *jCol, Ipopt::Number *values) override
-    {
-        return true;
-    }
+                Ipopt::Index *jCol, Ipopt::Number *values) override;
+
+    /***************************************************/
+    bool intermediate_callback(Ipopt::AlgorithmMode mode, Ipopt::Index iter,
+                               Ipopt::Number obj_value, Ipopt::Number inf_pr,
+                               Ipopt::Number inf_du, Ipopt::Number mu,
+                               Ipopt::Number d_norm, Ipopt::Number regularization_size,
+                               Ipopt::Number alpha_du, Ipopt::Number alpha_pr,
+                               Ipopt::Index ls_trials, const Ipopt::IpoptData *ip_data,
+                               Ipopt::IpoptCalculatedQuantities *ip_cq) override;
 
     /***************************************************/
     void finalize_solution(Ipopt::SolverReturn status,
@@ -76,31 +278,479 @@ protected:
 
 public:
     /***************************************************/
-    Grasp(const Problem &problem_) : problem(problem_), result(2) { }
+    Grasp(const Problem &problem_, const size_t num_contacts_=2,
+          const HessianMode hessian=HessianMode::limited_memory,
+          const Parametrization parametrization_=Parametrization::angle) :
+          problem(&problem_), num_contacts((Ipopt::Index)num_contacts_),
+          result(num_contacts_), candidate(num_contacts_), iterate(3*num_contacts_),
+          parametrization(parametrization_),
+          order(hessian==HessianMode::exact?2:1), forces(num_contacts_) { }
+
+    /***************************************************/
+    void bind(const Problem &problem_)
+    {
+        problem=&problem_;
+        arc.reset();
+        cached_order=-1;
+
+        // the retained solution does not fit other shapes
+        if ((problem->get_shape()!=warm_shape) || (problem->get_widths()!=warm_widths)) {
+            warm_x.clear();
+        }
+    }
+
+    /***************************************************/
+    void set_seed(const std::vector<Force> &seed_)
+    {
+        seed=seed_;
+    }
+
+    /***************************************************/
+    void set_cancel(const std::atomic<bool> *cancel_)
+    {
+        cancel=cancel_;
+    }
+
+    /***************************************************/
+    void set_deadline(const std::chrono::steady_clock::time_point &deadline_)
+    {
+        deadline=deadline_;
+    }
+
+    /***************************************************/
+    void set_warm_start(const bool warm_start_)
+    {
+        warm_start=warm_start_;
+    }
+
+    /***************************************************/
+    bool has_warm_start() const
+    {
+        return !warm_x.empty();
+    }
 
     /***************************************************/
     const std::vector<Force>& get_result() const
     {
         return result;
     }
+
+    /***************************************************/
+    size_t get_num_contacts() const
+    {
+        return (size_t)num_contacts;
+    }
+
+    /***************************************************/
+    Ipopt::Index get_iterations() const
+    {
+        return stats.iterations;
+    }
+
+    /***************************************************/
+    Ipopt::SolverReturn get_status() const
+    {
+        return stats.status;
+    }
+
+    /***************************************************/
+    void reset_stats()
+    {
+        stats=SolveStats();
+    }
+
+    /***************************************************/
+    const SolveStats& get_stats() const
+    {
+        return stats;
+    }
 };
 
 /**
  * Solver API.
+ *
+ * Besides the static one-shot solve(), a Solver instance keeps
+ * the configured Ipopt application and the NLP alive, so that
+ * the setup cost is paid once across many calls to compute().
  */
 class Solver
 {
+    Ipopt::SmartPtr<Ipopt::IpoptApplication> app;
+    Ipopt::SmartPtr<Grasp> nlp;
+    const Problem *tracked{nullptr};
+    HessianMode hessian;
+    size_t num_contacts;
+    Parametrization parametrization;
+    size_t map_resolution{0};
+    SolveStats stats;
+
+    std::vector<Force> optimize(const Problem& problem, const std::vector<Force>& seed,
+                                const std::atomic<bool> *cancel,
+                                const std::chrono::steady_clock::time_point &deadline);
+
 public:
+   /**
+    * Constructor.
+    * @param verbose to enable verbosity.
+    * @param hessian to select how to deal with the Hessian.
+    * @param num_contacts is the number of free contacts (fingers).
+    * @param parametrization to select the variable locating the contacts.
+    */
+    explicit Solver(const bool verbose=false,
+                    const HessianMode hessian=HessianMode::limited_memory,
+                    const size_t num_contacts=2,
+                    const Parametrization parametrization=Parametrization::angle);
+
+   /**
+    * Solve the problem reusing the internal Ipopt application.
+    *
+    * Circles grasped with two contacts are solved in closed form
+    * whenever possible (see ContactSolver::solve_circle()): this holds
+    * also for compute_within(), track() and the multi-start search of
+    * BatchSolver. The contacts lie apart, except on frictionless
+    * circles, where the only optimum puts both of them at the same
+    * location, each applying -F/2.
+    * @param problem to solve.
+    * @return a vector containing the applied forces.
+    */
+    std::vector<Force> compute(const Problem& problem);
+
+   /**
+    * Seed the solves given no starting point with the least-residual
+    * cell of a GraspMap of the problem (two contacts only), in place
+    * of the default contacts evenly spread around F.
+    * @param resolution is the number of samples per contact angle
+    *        of the map; 0 disables the seeding, which is the default.
+    */
+    void set_map_seeding(const size_t resolution);
+
+   /**
+    * Solve the problem from a given starting point.
+    * @param problem to solve.
+    * @param seed is the vector of forces used as starting point;
+    *        if empty, the default starting point is used, and circles
+    *        are solved in closed form as in compute() unless cancel
+    *        is raised already.
+    * @param cancel is an optional flag polled at each iteration:
+    *        when raised, the solver stops as soon as possible.
+    * @return a vector containing the applied forces.
+    */
+    std::vector<Force> compute(const Problem& problem,
+                               const std::vector<Force>& seed,
+                               const std::atomic<bool> *cancel=nullptr);
+
+   /**
+    * Solve the problem within a wall-clock budget, as required
+    * by fixed-rate control loops.
+    *
+    * Ipopt is stopped at the first iteration past the deadline and,
+    * unless it converged, the best feasible iterate met so far is
+    * returned. If there is none, the fixed-contacts heuristic of
+    * ContactSolver on a coarse grid provides the forces (two contacts
+    * only), which makes the budget overrun by the cost of one Ipopt
+    * iteration plus that of the heuristic at most.
+    * @param problem to solve.
+    * @param budget is the wall-clock budget in seconds.
+    * @param seed is the vector of forces used as starting point;
+    *        if empty, the default starting point is used.
+    * @return a vector containing the applied forces, whose quality
+    *         is reported by get_stats().
+    */
+    std::vector<Force> compute_within(const Problem& problem, const double budget,
+                                      const std::vector<Force>& seed=std::vector<Force>());
+
+   /**
+    * Solve the problem warm-starting Ipopt from the primal-dual solution
+    * of the previous solve, which suits streams of problems that differ
+    * slightly from one call to the next, e.g. in the load only (see
+    * Problem::configure_load()). Only a previous call to track() on
+    * the same problem provides the warm start: the first call, any call
+    * following another kind of solve or a solve that did not converge,
+    * and any call after the shape changed start cold.
+    * @param problem to solve.
+    * @return a vector containing the applied forces.
+    */
+    std::vector<Force> track(const Problem& problem);
+
+   /**
+    * Update the load of the problem and solve it warm-starting Ipopt
+    * from the primal-dual solution of the previous solve.
+    * @param problem to update and solve.
+    * @param friction is in range [0,1].
+    * @param F is the applied force.
+    * @return a vector containing the applied forces, or an empty vector
+    *         if the load could not be configured.
+    */
+    std::vector<Force> track(Problem& problem, const double friction, const Force& F);
+
+   /**
+    * Retrieve the number of iterations of the last compute().
+    * @return the number of iterations.
+    */
+    int get_iterations() const;
+
+   /**
+    * Retrieve the return status of the last compute().
+    * @return the status; closed-form solutions report success.
+    */
+    Ipopt::SolverReturn get_status() const;
+
+   /**
+    * Retrieve the statistics of the last compute().
+    * @return the statistics.
+    */
+    const SolveStats& get_stats() const;
+
+   /**
+    * Create an Ipopt application configured for the Grasp NLP.
+    * @param verbose to enable verbosity.
+    * @param hessian to select how to deal with the Hessian.
+    * @return the initialized application.
+    */
+    static Ipopt::SmartPtr<Ipopt::IpoptApplication> make_application(const bool verbose=true,
+                                                                     const HessianMode hessian=HessianMode::limited_memory);
+
    /**
     * Solve the problem.
     * @param problem to solve.
     * @param verbose to enable verbosity.
+    * @param hessian to select how to deal with the Hessian.
+    * @param num_contacts is the number of free contacts (fingers).
+    * @param stats is optionally filled with the statistics of the solve.
     * @return a vector containing the applied forces.
     */
     static std::vector<Force> solve(const Problem& problem,
-                                    const bool verbose=true);
+                                    const bool verbose=true,
+                                    const HessianMode hessian=HessianMode::limited_memory,
+                                    const size_t num_contacts=2,
+                                    SolveStats *stats=nullptr);
+};
+
+/**
+ * Options for the multi-start search.
+ * - grid:       number of samples per contact angle used to
+ *               build the candidate seeds.
+ * - num_starts: number of best-ranked seeds actually solved.
+ * - F_eps:      tolerance on |F| to accept a solution.
+ * - T_eps:      tolerance on |T| to accept a solution.
+ */
+struct MultiStartOptions {
+    size_t grid{12};
+    size_t num_starts{8};
+    double F_eps{.01};
+    double T_eps{.01};
+};
+
+/**
+ * Batch Solver API.
+ *
+ * Problems are solved in parallel over a work-stealing pool,
+ * where each worker owns its Solver instance.
+ *
+ * @note Problem is safe for concurrent reads through its const
+ *       methods, hence the same Problem may appear several times
+ *       within a batch; configure() must not run concurrently.
+ */
+class BatchSolver
+{
+    ThreadPool pool;
+    std::vector<std::unique_ptr<Solver>> solvers;
+    size_t num_contacts;
+
+    static const Problem* as_ptr(const Problem& problem) { return &problem; }
+    static const Problem* as_ptr(const Problem* problem) { return problem; }
+    static const Problem* as_ptr(const std::shared_ptr<Problem>& problem) { return problem.get(); }
+
+public:
+   /**
+    * Constructor.
+    * @param num_workers is the number of workers; 0 means as many
+    *        as the hardware concurrency.
+    * @param hessian to select how to deal with the Hessian.
+    * @param num_contacts is the number of free contacts (fingers).
+    */
+    explicit BatchSolver(const size_t num_workers=0,
+                         const HessianMode hessian=HessianMode::limited_memory,
+                         const size_t num_contacts=2);
+
+   /**
+    * Retrieve the number of workers.
+    * @return the number of workers.
+    */
+    size_t get_num_workers() const;
+
+   /**
+    * Retrieve the number of free contacts.
+    * @return the number of contacts.
+    */
+    size_t get_num_contacts() const;
+
+   /**
+    * Seed the solves of the batches with GraspMap (see
+    * Solver::set_map_seeding()); multi-start searches use their own seeds.
+    * @param resolution is the number of samples per contact angle
+    *        of the map; 0 disables the seeding, which is the default.
+    */
+    void set_map_seeding(const size_t resolution);
+
+   /**
+    * Solve a batch of problems.
+    * @param problems to solve.
+    * @return the vectors of applied forces, in the same order as the problems.
+    */
+    std::vector<std::vector<Force>> solve_batch(const std::vector<const Problem*>& problems);
+
+   /**
+    * Solve one problem with a parallel multi-start search.
+    *
+    * Seeds are the combinations of contact angles taken from a coarse
+    * grid, ranked by the residual of the normal-force-only balance. The
+    * best ones are solved in parallel and, as soon as one satisfies
+    * the tolerances without slippage, the others are cancelled.
+    * @param problem to solve.
+    * @param options of the search.
+    * @return the accepted forces or, if none, those with the smallest residuals.
+    */
+    std::vector<Force> solve_multistart(const Problem& problem,
+                                        const MultiStartOptions& options=MultiStartOptions());
+
+   /**
+    * Run fn(solver,i) for all i in [0,n) over the pool, blocking until completion.
+    * @param n is the number of work items.
+    * @param fn is the function to execute, which receives the Solver
+    *        owned by the worker running it and the index of the item.
+    */
+    void parallel_for(const size_t n,
+                      const std::function<void(Solver&, const size_t)> &fn);
+
+   /**
+    * Solve a range of problems.
+    * @param first is the beginning of the range of problems, which may be
+    *        given as Problem, pointers or shared pointers to Problem.
+    * @param last is the end of the range.
+    * @return the vectors of applied forces, in the same order as the problems.
+    */
+    template<typename Iterator>
+    std::vector<std::vector<Force>> solve_batch(Iterator first, Iterator last)
+    {
+        std::vector<const Problem*> problems;
+        for (; first!=last; ++first) {
+            problems.push_back(as_ptr(*first));
+        }
+        return solve_batch(problems);
+    }
+};
+
+/**
+ * Token to cancel asynchronous requests cooperatively.
+ *
+ * Copies share the same flag, which the solver polls at each
+ * Ipopt iteration: once raised, the request stops at the next one.
+ */
+class CancelToken
+{
+    std::shared_ptr<std::atomic<bool>> flag;
+
+public:
+    /***************************************************/
+    CancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) { }
+
+    /***************************************************/
+    void cancel() const
+    {
+        flag->store(true);
+    }
+
+    /***************************************************/
+    bool is_cancelled() const
+    {
+        return flag->load();
+    }
+
+    /***************************************************/
+    const std::atomic<bool>* get() const
+    {
+        return flag.get();
+    }
+};
+
+/**
+ * Outcome of an asynchronous request.
+ */
+struct AsyncResult {
+    std::vector<Force> forces;
+    SolveStats stats;
+    bool cancelled{false};
+};
+
+/**
+ * Asynchronous Solver API.
+ *
+ * Requests are queued to an internal executor whose workers own
+ * their Solver instance, and served in FIFO order while the calling
+ * thread keeps running. Each request copies its Problem, which can
+ * then be reconfigured freely by the caller.
+ */
+class AsyncSolver
+{
+    struct Request {
+        Problem problem;
+        std::vector<Force> seed;
+        CancelToken token;
+        std::promise<AsyncResult> promise;
+    };
+
+    std::vector<std::unique_ptr<Solver>> solvers;
+    std::vector<std::thread> workers;
+    std::deque<Request> requests;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool closing{false};
+
+    void loop(const size_t worker);
+
+public:
+   /**
+    * Constructor.
+    * @param num_workers is the number of requests served concurrently.
+    * @param hessian to select how to deal with the Hessian.
+    * @param num_contacts is the number of free contacts (fingers).
+    */
+    explicit AsyncSolver(const size_t num_workers=1,
+                         const HessianMode hessian=HessianMode::limited_memory,
+                         const size_t num_contacts=2);
+
+   /**
+    * Destructor: pending requests are resolved as cancelled, while
+    * those being served are waited for.
+    */
+    ~AsyncSolver();
+
+    AsyncSolver(const AsyncSolver&) = delete;
+    AsyncSolver& operator=(const AsyncSolver&) = delete;
+
+   /**
+    * Retrieve the number of workers.
+    * @return the number of workers.
+    */
+    size_t get_num_workers() const;
+
+   /**
+    * Queue a request without blocking.
+    * @param problem to solve, which gets copied.
+    * @param token is polled at each Ipopt iteration: once raised,
+    *        the request stops within one iteration and resolves with
+    *        the forces reached so far, or with no forces at all if
+    *        it was not started yet.
+    * @param seed is the vector of forces used as starting point;
+    *        if empty, the default starting point is used.
+    * @return the future outcome of the request.
+    */
+    std::future<AsyncResult> solve_async(const Problem& problem,
+                                         const CancelToken& token=CancelToken(),
+                                         const std::vector<Force>& seed=std::vector<Force>());
 };
 
 }
 
-#endif
+#endif
\ No newline at end of file
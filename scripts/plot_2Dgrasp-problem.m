@@ -18,20 +18,28 @@ end
 arg_list=argv();
 filename=arg_list{1};
 
-% load data
+% load data, detecting the binary format through its magic
 fid=fopen(filename,'r');
-N=fscanf(fid,'%d',1);
-p=zeros(N,3);
-for i=1:N
-  p(i,:)=fscanf(fid,'%f %f %f',[1 3]);
+magic=fread(fid,[1 8],'char=>char');
+if strcmp(magic,'2DGRASPO')
+  header=fread(fid,4,'uint32');
+  N=header(2); M=header(3);
+  p=fread(fid,[3 N],'double')';
+  friction=fread(fid,1,'double');
+  F=fread(fid,[8 M],'double')';
+  COM=fread(fid,[1 2],'double');
+  Ft=fread(fid,[1 2],'double');
+  Tt=fread(fid,1,'double');
+else
+  frewind(fid);
+  N=fscanf(fid,'%d',1);
+  p=fscanf(fid,'%f',[3 N])';
+  friction=fscanf(fid,'%f',1);
+  F=fscanf(fid,'%f',[8 3])';
+  COM=fscanf(fid,'%f',[1 2]);
+  Ft=fscanf(fid,'%f',[1 2]);
+  Tt=fscanf(fid,'%f',1);
 end
-friction=fscanf(fid,'%f',1);
-F0=fscanf(fid,'%f %f %f %f %f %f %f %f',[1 8]);
-F1=fscanf(fid,'%f %f %f %f %f %f %f %f',[1 8]);
-F2=fscanf(fid,'%f %f %f %f %f %f %f %f',[1 8]);
-COM=fscanf(fid,'%f %f',[1 2]);
-Ft=fscanf(fid,'%f %f',[1 2]);
-Tt=fscanf(fid,'%f',1);
 fclose(fid);
 
 % plot data
@@ -42,12 +50,14 @@ set(gca,'layer','top');
 axis('equal');
 patch(p(:,2),p(:,3),'facecolor',[255 255 196]/255);
 plot(COM(1),COM(2),'ro');
-quiver(F0(1),F0(2),F0(3)+F0(5),F0(4)+F0(6),'k');
-quiver(F1(1),F1(2),F1(3)+F1(5),F1(4)+F1(6),'r');
-quiver(F2(1),F2(2),F2(3)+F2(5),F2(4)+F2(6),'r');
-display_friction_cone(F0,friction);
-display_friction_cone(F1,friction);
-display_friction_cone(F2,friction);
+for i=1:size(F,1)
+  color='r';
+  if i==1
+    color='k';
+  end
+  quiver(F(i,1),F(i,2),F(i,3)+F(i,5),F(i,4)+F(i,6),color);
+  display_friction_cone(F(i,:),friction);
+end
 text(1.05,.95,sprintf('F = (%.3f %.3f)',Ft(1),Ft(2)));
 text(1.05,.85,sprintf('T = %.3f',Tt));
 
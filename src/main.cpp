@@ -3,12 +3,15 @@
 // Author: Ugo Pattacini - <ugo.pattacini@iit.it>
 
 #include <cstdlib>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <utility>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <numeric>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <fstream>
@@ -36,6 +39,119 @@ string forceToString(shared_ptr<Problem> problem,
     return ss.str();
 }
 
+/***************************************************/
+vector<double> sample_uniform(const size_t num_samples)
+{
+    vector<double> tval(num_samples);
+    iota(begin(tval),end(tval),0.);
+    for (auto &t:tval) {
+        t*=2.*M_PI/tval.size();
+    }
+    return tval;
+}
+
+/***************************************************/
+vector<double> sample_adaptive(shared_ptr<Problem> problem,
+                               const double tolerance)
+{
+    // curvature of the perimeter at t
+    auto curvature=[&](const double t) {
+        auto dP=problem->eval_dP(t);
+        auto n=norm(dP);
+        return fabs(cross(dP,problem->eval_d2P(t)))/(n*n*n);
+    };
+
+    // a chord of length L spanning an arc of curvature k deviates
+    // from it by about k*L^2/8: split the arc until this sagitta
+    // drops below the tolerance
+    const size_t num_coarse=16;
+    const int max_depth=12;
+    vector<double> tval;
+    vector<pair<pair<double,double>,int>> stack;
+    for (size_t i=num_coarse; i>0; i--) {
+        stack.push_back(make_pair(make_pair((2.*M_PI*(i-1))/num_coarse,
+                                            (2.*M_PI*i)/num_coarse),0));
+    }
+    while (!stack.empty()) {
+        auto arc=stack.back(); stack.pop_back();
+        auto a=arc.first.first;
+        auto b=arc.first.second;
+        auto m=.5*(a+b);
+        auto L=norm(problem->eval_P(b)-problem->eval_P(a));
+        auto k=std::max(curvature(a),std::max(curvature(m),curvature(b)));
+        if ((arc.second<max_depth) && (k*L*L/8.>tolerance)) {
+            stack.push_back(make_pair(make_pair(m,b),arc.second+1));
+            stack.push_back(make_pair(make_pair(a,m),arc.second+1));
+        } else {
+            tval.push_back(a);
+        }
+    }
+    return tval;
+}
+
+/***************************************************/
+void write_text(const string& filename, shared_ptr<Problem> problem,
+                const vector<double>& tval, const vector<Force>& forces,
+                const pair<Vector,double>& F_T)
+{
+    ofstream fout(filename);
+    fout.precision(5); fout << fixed;
+
+    fout << tval.size() << endl;
+    for (auto &t:tval) {
+        fout << t << " " << problem->get_P(t).toString(5,5) << endl;
+    }
+    fout << problem->get_friction() << endl;
+    fout << forceToString(problem,problem->get_F()) << " " << problem->get_N(problem->get_F().t).toString(5,5) << endl;
+    fout << forceToString(problem,forces[0]) << " " << problem->get_N(forces[0].t).toString(5,5) << endl;
+    fout << forceToString(problem,forces[1]) << " " << problem->get_N(forces[1].t).toString(5,5) << endl;
+    fout << problem->get_COM().toString(5,5) << endl;
+    fout << F_T.first.toString(5,5) << endl;
+    fout << F_T.second<< endl;
+
+    fout.close();
+}
+
+/***************************************************/
+bool write_binary(const string& filename, shared_ptr<Problem> problem,
+                  const vector<double>& tval, const vector<Force>& forces,
+                  const pair<Vector,double>& F_T)
+{
+    // layout (native byte order):
+    // "2DGRASPO" | uint32 version | uint32 #samples | uint32 #forces | uint32 pad
+    // #samples x [t Px Py] | friction | #forces x [Px Py Fnx Fny Ftx Fty Nx Ny]
+    // COMx COMy | Fx Fy | T
+    // forces start with F, followed by the solved ones
+    vector<Force> all(1,problem->get_F());
+    all.insert(end(all),begin(forces),end(forces));
+
+    const uint32_t header[4]={1,(uint32_t)tval.size(),(uint32_t)all.size(),0};
+    vector<double> data;
+    data.reserve(3*tval.size()+1+8*all.size()+5);
+    for (auto &t:tval) {
+        auto P=problem->eval_P(t);
+        data.insert(end(data),{t,P.x,P.y});
+    }
+    data.push_back(problem->get_friction());
+    for (auto &f:all) {
+        auto P=problem->eval_P(f.t);
+        auto N=problem->eval_N(f.t);
+        auto T=problem->eval_T(f.t);
+        data.insert(end(data),{P.x,P.y,f.fn*N.x,f.fn*N.y,f.ft*T.x,f.ft*T.y,N.x,N.y});
+    }
+    const auto &COM=problem->eval_COM();
+    data.insert(end(data),{COM.x,COM.y,F_T.first[0],F_T.first[1],F_T.second});
+
+    auto fout=fopen(filename.c_str(),"wb");
+    if (fout==nullptr) {
+        return false;
+    }
+    auto ok=(fwrite("2DGRASPO",1,8,fout)==8) &&
+            (fwrite(header,sizeof(uint32_t),4,fout)==4) &&
+            (fwrite(data.data(),sizeof(double),data.size(),fout)==data.size());
+    return ((fclose(fout)==0) && ok);
+}
+
 /***************************************************/
 int main(int argc, char* argv[])
 {
@@ -50,13 +166,57 @@ int main(int argc, char* argv[])
         cerr << "Unrecognized shape \"" << type << "\"" << endl;
         return EXIT_FAILURE;
     }
+    auto format=rf.check("format",Value("text")).asString();
+    if ((format!="text") && (format!="binary")) {
+        cerr << "Unrecognized format \"" << format << "\"" << endl;
+        return EXIT_FAILURE;
+    }
+    auto sampling=rf.check("sampling",Value("uniform")).asString();
+    if ((sampling!="uniform") && (sampling!="adaptive")) {
+        cerr << "Unrecognized sampling \"" << sampling << "\"" << endl;
+        return EXIT_FAILURE;
+    }
+    auto num_samples=rf.check("samples",Value(1000)).asInt32();
+    auto tolerance=rf.check("tolerance",Value(5e-5)).asFloat64();
+    if ((num_samples<=0) || (tolerance<=0.)) {
+        cerr << "Samples and tolerance must be positive" << endl;
+        return EXIT_FAILURE;
+    }
+    auto budget=rf.check("budget",Value(0.)).asFloat64();
+    if (budget<0.) {
+        cerr << "Budget must be nonnegative" << endl;
+        return EXIT_FAILURE;
+    }
+    auto filename=rf.check("output",Value("problem.out")).asString();
+    auto stats_format=rf.check("stats-format",Value("csv")).asString();
+    if ((stats_format!="csv") && (stats_format!="json")) {
+        cerr << "Unrecognized stats format \"" << stats_format << "\"" << endl;
+        return EXIT_FAILURE;
+    }
 
     auto problem=Problem::generate();
     if (type=="circle") {
         auto F=problem->get_F(); F.ft=0.;
         problem->configure(vector<double>({.0,.0,.0,.0}),problem->get_friction(),F);
     }
-    auto forces=Solver::solve(*problem);
+    SolveStats stats;
+    vector<Force> forces;
+    if (budget>0.) {
+        // quiet, as printing would eat into the budget
+        Solver solver(false);
+        forces=solver.compute_within(*problem,budget);
+        stats=solver.get_stats();
+        const char *quality[]={"converged","feasible","fallback"};
+        cout << "quality = " << quality[(int)stats.quality] << endl;
+    } else {
+        forces=Solver::solve(*problem,true,HessianMode::limited_memory,2,&stats);
+    }
+    if (rf.check("stats")) {
+        auto stats_file=rf.find("stats").asString();
+        if (!stats.append(stats_file,stats_format=="json")) {
+            cerr << "Unable to append stats to \"" << stats_file << "\"" << endl;
+        }
+    }
     auto F_T=problem->compute_newton_law(forces);
 
     cout.precision(5); cout << fixed;
@@ -66,24 +226,16 @@ int main(int argc, char* argv[])
         cerr << "Solved forces are causing slippage!" << endl;
     }
 
-    vector<double> tval(1000);
-    iota(begin(tval),end(tval),0.);
-
-    ofstream fout("problem.out");
-
-    fout << tval.size() << endl;
-    for (auto &t:tval) {
-        t*=2.*M_PI/tval.size();
-        fout << t << " " << problem->get_P(t).toString(5,5) << endl;
+    auto tval=(sampling=="adaptive"?sample_adaptive(problem,tolerance):
+                                    sample_uniform((size_t)num_samples));
+    if (format=="binary") {
+        if (!write_binary(filename,problem,tval,forces,F_T)) {
+            cerr << "Unable to write \"" << filename << "\"" << endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        write_text(filename,problem,tval,forces,F_T);
     }
-    fout << problem->get_friction() << endl;
-    fout << forceToString(problem,problem->get_F()) << " " << problem->get_N(problem->get_F().t).toString(5,5) << endl;
-    fout << forceToString(problem,forces[0]) << " " << problem->get_N(forces[0].t).toString(5,5) << endl;
-    fout << forceToString(problem,forces[1]) << " " << problem->get_N(forces[1].t).toString(5,5) << endl;
-    fout << problem->get_COM().toString(5,5) << endl;
-    fout << F_T.first.toString(5,5) << endl;
-    fout << F_T.second<< endl;
-    
-    fout.close();
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,156 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "problem.h"
+#include "generator.h"
+#include "arclength.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+double speed(const Problem& problem, const double t)
+{
+    return norm(problem.eval_dP(t));
+}
+
+/***************************************************/
+double reference_length(const Problem& problem, const double t)
+{
+    // composite Simpson's rule on a fine grid
+    const size_t n=1<<16;
+    auto h=t/n;
+    auto sum=speed(problem,0.)+speed(problem,t);
+    for (size_t i=1; i<n; i++) {
+        sum+=(i%2==1?4.:2.)*speed(problem,i*h);
+    }
+    return sum*h/3.;
+}
+
+/***************************************************/
+void check_table(const Problem& problem, const size_t resolution, const double accuracy,
+                 const string& what)
+{
+    // the table follows the true arc length up to an accuracy that
+    // depends on how many cells span the sharpest features
+    ArcLength arc(problem,resolution);
+    auto L=arc.get_length();
+    check_near(L,reference_length(problem,2.*M_PI),accuracy*L,what+" length");
+    for (double t=.1; t<2.*M_PI; t+=.7) {
+        check_near(arc.eval_length(t),reference_length(problem,t),accuracy*L,
+                   what+" length at t="+to_string(t));
+    }
+
+    for (double s=-7.; s<14.; s+=.013) {
+        auto where=what+" s="+to_string(s);
+
+        // round trips in both directions, across the wrapping
+        auto angle_diff=[](const double a, const double b) {
+            return Problem::wrap_angle(a-b+M_PI)-M_PI;
+        };
+        auto l=arc.eval_length(s);
+        check((l>=0.) && (l<L),where+" length within the perimeter");
+        check_near(angle_diff(arc.eval_angle(l),s),0.,1e-12,where+" t->s->t");
+        check_near(arc.eval_length(arc.eval_angle(s)),fmod(fmod(s,L)+L,L),1e-12*L,
+                   where+" s->t->s");
+        check_near(angle_diff(arc.eval_angle(s+L),arc.eval_angle(s)),0.,1e-12,
+                   where+" periodicity");
+
+        // the jets are the derivatives of the table's own t(s),
+        // whereas dt/ds=1/|dP| holds up to the accuracy of the table
+        auto jet=arc.eval_angle_jet<3>(s);
+        const auto e1=1e-6;
+        const auto e2=2e-6;
+        auto d1=angle_diff(arc.eval_angle(s+e1),arc.eval_angle(s-e1))/(2.*e1);
+        auto d2=(arc.eval_angle_jet<1>(s+e2).derivative(1)-
+                 arc.eval_angle_jet<1>(s-e2).derivative(1))/(2.*e2);
+        auto d3=(arc.eval_angle_jet<2>(s+e2).derivative(2)-
+                 arc.eval_angle_jet<2>(s-e2).derivative(2))/(2.*e2);
+        check_near(jet.derivative(1),d1,1e-6*fabs(d1),where+" dt/ds");
+        check_near(jet.derivative(2),d2,1e-4*(1.+fabs(d2)),where+" d2t/ds2");
+        check_near(jet.derivative(3),d3,1e-4*(1.+fabs(d3)),where+" d3t/ds3");
+        auto t0=jet.value();
+        check_near(jet.derivative(1)*norm(problem.eval_dP(t0)),1.,accuracy,where+" unit speed");
+
+        // the wrench due to unit forces along the unit frame
+        auto wrench=arc.eval_wrench_jet<3>(problem,s);
+        auto frame=problem.eval_frame(t0);
+        auto r=frame.P-problem.eval_COM();
+        auto N=frame.N/norm(frame.N);
+        auto T=frame.T/norm(frame.T);
+        double normal[3]={N.x,N.y,cross(r,N)};
+        double tangential[3]={T.x,T.y,cross(r,T)};
+        auto wp=arc.eval_wrench_jet<1>(problem,s+e2);
+        auto wm=arc.eval_wrench_jet<1>(problem,s-e2);
+        for (size_t j=0; j<3; j++) {
+            auto c=to_string(j);
+            check_near(wrench.normal[j].value(),normal[j],1e-12,where+" normal["+c+"]");
+            check_near(wrench.tangential[j].value(),tangential[j],1e-12,where+" tangential["+c+"]");
+            for (size_t k=1; k<=2; k++) {
+                auto dn=(wp.normal[j].derivative(k-1)-wm.normal[j].derivative(k-1))/(2.*e2);
+                auto dt=(wp.tangential[j].derivative(k-1)-wm.tangential[j].derivative(k-1))/(2.*e2);
+                check_near(wrench.normal[j].derivative(k),dn,1e-3*(1.+fabs(dn)),
+                           where+" normal["+c+"] derivative "+to_string(k));
+                check_near(wrench.tangential[j].derivative(k),dt,1e-3*(1.+fabs(dt)),
+                           where+" tangential["+c+"] derivative "+to_string(k));
+            }
+        }
+    }
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    // the automatic resolution scales with the number of lobes, their
+    // widths and their amplitudes, keeping the same accuracy
+    for (size_t K:{3,4,7,12}) {
+        Generator generator(K,K);
+        Problem problem;
+        for (int i=0; i<5; i++) {
+            generator.generate(problem);
+            auto what="K="+to_string(K)+" problem="+to_string(i);
+            check(ArcLength::calc_resolution(problem)>=512,what+" resolution");
+            check(ArcLength(problem).get_resolution()==ArcLength::calc_resolution(problem),
+                  what+" automatic resolution");
+            check_table(problem,0,1e-6,what);
+
+            // lobes half as wide
+            auto widths=problem.get_widths();
+            for (auto &w:widths) {
+                w/=2.;
+            }
+            check(problem.configure(problem.get_shape(),widths,problem.get_friction(),problem.get_F()),
+                  what+" configure narrow widths");
+            check_table(problem,0,1e-6,what+" narrow widths");
+        }
+    }
+
+    // narrow lobes with many cells each are given up on
+    Problem sharp;
+    check(sharp.configure(vector<double>(64,.3),vector<double>(64,.0025),.5,Force{0.,1.,0.}),
+          "configure sharp lobes");
+    check(ArcLength::calc_resolution(sharp)==0,"sharp lobes rejected");
+
+    // the unit circle is parametrized by arc length already
+    Problem circle;
+    check(circle.configure(vector<double>(4,0.),.5,Force{0.,1.,0.}),"configure circle");
+    ArcLength arc(circle);
+    check(arc.get_resolution()==512,"circle resolution");
+    check_near(arc.get_length(),2.*M_PI,1e-12,"circle length");
+    for (double s=0.; s<2.*M_PI; s+=.1) {
+        check_near(arc.eval_angle(s),s,1e-12,"circle angle at s="+to_string(s));
+    }
+    check_table(circle,512,1e-12,"circle");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "problem.h"
+#include "generator.h"
+#include "contact.h"
+#include "solver.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/**
+ * Expose the callbacks of the NLP, which Ipopt would call.
+ */
+struct GraspCallbacks : public Grasp {
+    using Grasp::Grasp;
+    using Grasp::get_nlp_info;
+    using Grasp::eval_grad_f;
+    using Grasp::eval_jac_g;
+};
+
+/***************************************************/
+double check_kkt(const Problem& problem, const vector<Force>& forces)
+{
+    GraspCallbacks nlp(problem);
+    Ipopt::Index n,m,nnz_jac,nnz_h;
+    Ipopt::TNLP::IndexStyleEnum style;
+    nlp.get_nlp_info(n,m,nnz_jac,nnz_h,style);
+
+    vector<double> x;
+    for (auto &f:forces) {
+        x.insert(end(x),{f.t,f.fn,f.ft});
+    }
+    vector<double> grad(n),jac(nnz_jac);
+    vector<Ipopt::Index> rows(nnz_jac),cols(nnz_jac);
+    nlp.eval_grad_f(n,x.data(),true,grad.data());
+    nlp.eval_jac_g(n,x.data(),false,m,nnz_jac,rows.data(),cols.data(),nullptr);
+    nlp.eval_jac_g(n,x.data(),false,m,nnz_jac,nullptr,nullptr,jac.data());
+
+    // the friction cones are inactive, thus the gradient of the objective
+    // must lie in the span of the gradients of Newton's law: solve the
+    // normal equations A*lambda=-J*grad with A=J*J^T for the multipliers
+    vector<double> J(3*n,0.);
+    for (Ipopt::Index k=0; k<nnz_jac; k++) {
+        if (rows[k]<3) {
+            J[rows[k]*n+cols[k]]+=jac[k];
+        }
+    }
+    double A[3][4];
+    for (int i=0; i<3; i++) {
+        for (int j=0; j<3; j++) {
+            A[i][j]=0.;
+            for (Ipopt::Index k=0; k<n; k++) {
+                A[i][j]+=J[i*n+k]*J[j*n+k];
+            }
+        }
+        A[i][3]=0.;
+        for (Ipopt::Index k=0; k<n; k++) {
+            A[i][3]-=J[i*n+k]*grad[k];
+        }
+    }
+    for (int i=0; i<3; i++) {
+        for (int r=i+1; r<3; r++) {
+            auto c=A[r][i]/A[i][i];
+            for (int j=i; j<4; j++) {
+                A[r][j]-=c*A[i][j];
+            }
+        }
+    }
+    double lambda[3];
+    for (int i=2; i>=0; i--) {
+        lambda[i]=A[i][3];
+        for (int j=i+1; j<3; j++) {
+            lambda[i]-=A[i][j]*lambda[j];
+        }
+        lambda[i]/=A[i][i];
+    }
+
+    double residual=0.;
+    for (Ipopt::Index k=0; k<n; k++) {
+        auto r=grad[k];
+        for (int i=0; i<3; i++) {
+            r+=J[i*n+k]*lambda[i];
+        }
+        residual=std::max(residual,fabs(r));
+    }
+    return residual;
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    // circles carrying the loads of the generated problems
+    Generator generator(1);
+    for (int i=0; i<1000; i++) {
+        Problem problem;
+        generator.generate(problem);
+        auto what="problem="+to_string(i);
+        check(problem.configure(vector<double>(4,0.),problem.get_friction(),problem.get_F()),
+              what+" configure circle");
+
+        vector<Force> forces;
+        check(ContactSolver::solve_circle(problem,forces),what+" solved");
+        check(forces.size()==2,what+" two contacts");
+        check(problem.check_no_slippage(forces),what+" no slippage");
+
+        auto F_T=problem.compute_newton_law(forces);
+        check_near(hypot(F_T.first[0],F_T.first[1]),0.,1e-12,what+" force balance");
+        check_near(F_T.second,0.,1e-12,what+" torque balance");
+
+        // |F|^2/2 bounds the effort from below for any feasible grasp
+        const auto &F=problem.get_F();
+        auto effort=0.;
+        for (auto &f:forces) {
+            effort+=f.fn*f.fn+f.ft*f.ft;
+        }
+        check_near(effort,(F.fn*F.fn+F.ft*F.ft)/2.,1e-12,what+" least effort");
+        check_near(check_kkt(problem,forces),0.,1e-9,what+" stationarity");
+
+        // with friction, the contacts do not coincide unless F lies
+        // on the edge of the friction cone
+        auto slack=atan(problem.get_friction())-atan2(fabs(F.ft),fabs(F.fn));
+        auto gap=fabs(Problem::wrap_angle(forces[0].t-forces[1].t+M_PI)-M_PI);
+        check(gap>slack/10.,what+" distinct contacts");
+    }
+
+    // with no friction, the contacts coincide and push along -F
+    for (int i=0; i<100; i++) {
+        Problem problem;
+        generator.generate(problem);
+        auto what="frictionless problem="+to_string(i);
+        check(problem.configure(vector<double>(4,0.),0.,problem.get_F()),what+" configure circle");
+
+        vector<Force> forces;
+        check(ContactSolver::solve_circle(problem,forces),what+" solved");
+        auto F_T=problem.compute_newton_law(forces);
+        check_near(hypot(F_T.first[0],F_T.first[1]),0.,1e-12,what+" force balance");
+        check_near(F_T.second,0.,1e-12,what+" torque balance");
+        check_near(forces[0].t,forces[1].t,1e-12,what+" same contact");
+        check_near(forces[0].ft,0.,1e-12,what+" no tangential force");
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <iterator>
+#include "problem.h"
+#include "generator.h"
+#include "corpus.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+vector<char> load(const string &path)
+{
+    ifstream fin(path,ios::binary);
+    return vector<char>(istreambuf_iterator<char>(fin),istreambuf_iterator<char>());
+}
+
+/***************************************************/
+void save(const string &path, const vector<char> &bytes)
+{
+    ofstream fout(path,ios::binary|ios::trunc);
+    fout.write(bytes.data(),bytes.size());
+}
+
+/***************************************************/
+void check_same(const Problem &a, const Problem &b, const string &what)
+{
+    check(a.get_shape()==b.get_shape(),what+" shape");
+    check(a.get_widths()==b.get_widths(),what+" widths");
+    check(a.get_friction()==b.get_friction(),what+" friction");
+    check((a.get_F().t==b.get_F().t) && (a.get_F().fn==b.get_F().fn) &&
+          (a.get_F().ft==b.get_F().ft),what+" F");
+    for (double t=-1.; t<7.; t+=.37) {
+        auto Pa=a.eval_P(t);
+        auto Pb=b.eval_P(t);
+        check((Pa.x==Pb.x) && (Pa.y==Pb.y),what+" perimeter");
+    }
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    const string path="test_corpus.problems";
+    const size_t K=5;
+
+    // generated problems, some of which with custom lobe widths, and a circle
+    mt19937 rng(1);
+    uniform_real_distribution<double> width(.05,.5);
+    vector<Problem> problems(20);
+    Generator generator(1,K);
+    for (size_t i=0; i<problems.size(); i++) {
+        auto &problem=problems[i];
+        generator.generate(problem);
+        if (i%2==1) {
+            vector<double> widths(K);
+            for (auto &s:widths) {
+                s=width(rng);
+            }
+            check(problem.configure(problem.get_shape(),widths,problem.get_friction(),
+                                    problem.get_F()),"configure with widths");
+        }
+    }
+    check(problems.back().configure(vector<double>(K,0.),.5,Force{1.,1.,.2}),"configure circle");
+
+    {
+        CorpusWriter writer;
+        check(writer.open(path,K),"open writer");
+        for (auto &problem:problems) {
+            check(writer.write(problem),"write");
+        }
+        Problem other;
+        Generator(1,K+1).generate(other);
+        check(!writer.write(other),"number of lobes mismatch rejected");
+    }
+
+    {
+        CorpusReader reader;
+        check(reader.open(path),"open reader");
+        check(reader.size()==problems.size(),"number of records");
+        check(reader.get_num_lobes()==K,"number of lobes");
+        for (size_t i=0; i<problems.size(); i++) {
+            auto what="record="+to_string(i);
+            Problem problem;
+            check(reader.read(i,problem),what+" read");
+            check_same(problem,problems[i],what);
+            auto COM=reader.read_COM(i);
+            check((COM.x==problems[i].eval_COM().x) && (COM.y==problems[i].eval_COM().y),
+                  what+" COM");
+            check((problem.eval_COM().x==COM.x) && (problem.eval_COM().y==COM.y),
+                  what+" cached COM in use");
+        }
+    }
+
+    // corrupted headers are rejected
+    auto bytes=load(path);
+    auto corrupt=[&](const size_t offset, const uint64_t value, const size_t size) {
+        auto b=bytes;
+        memcpy(b.data()+offset,&value,size);
+        save(path,b);
+        CorpusReader reader;
+        return !reader.open(path);
+    };
+    check(corrupt(8,1,sizeof(uint32_t)),"previous version rejected");
+    check(corrupt(16,problems.size()+1,sizeof(uint64_t)),"count beyond the file rejected");
+    check(corrupt(16,(~uint64_t(0))/(sizeof(double)*(2*K+6))+1,sizeof(uint64_t)),
+          "overflowing count rejected");
+    check(corrupt(28,sizeof(double)*(K+6),sizeof(uint32_t)),"record size without widths rejected");
+    save(path,vector<char>(begin(bytes),end(bytes)-1));
+    {
+        CorpusReader reader;
+        check(!reader.open(path),"truncated file rejected");
+    }
+    remove(path.c_str());
+
+    // results are laid out in columns that can be read in place
+    const string results_path="test_corpus.results";
+    const size_t num_contacts=3;
+    const size_t count=10;
+    {
+        ResultWriter writer;
+        check(writer.open(results_path,count,num_contacts),"open result writer");
+        for (size_t i=0; i<count; i++) {
+            SolveResult result;
+            for (size_t k=0; k<num_contacts-(i%2); k++) {
+                result.forces.push_back(Force{1.*i,10.*k,.1*k});
+            }
+            result.F=Vec2(i,-1.*i);
+            result.T=.5*i;
+            result.status=(int32_t)i;
+            result.iterations=(int32_t)(2*i);
+            result.time_us=3.*i;
+            writer.write(i,result);
+        }
+    }
+
+    auto results=load(results_path);
+    remove(results_path.c_str());
+    uint32_t num_columns;
+    memcpy(&num_columns,results.data()+28,sizeof(num_columns));
+    check(num_columns==3*num_contacts+6,"number of columns");
+    auto column=[&](const string &name) {
+        for (uint32_t c=0; c<num_columns; c++) {
+            auto entry=results.data()+64+40*c;
+            if (name==entry) {
+                uint64_t offset;
+                memcpy(&offset,entry+32,sizeof(offset));
+                check(offset%64==0,name+" aligned");
+                return results.data()+offset;
+            }
+        }
+        check(false,name+" found");
+        return results.data();
+    };
+    for (size_t i=0; i<count; i++) {
+        auto what="result="+to_string(i);
+        double fn3,T;
+        int32_t iterations;
+        memcpy(&fn3,column("fn3")+i*sizeof(double),sizeof(double));
+        memcpy(&T,column("T")+i*sizeof(double),sizeof(double));
+        memcpy(&iterations,column("iterations")+i*sizeof(int32_t),sizeof(int32_t));
+        check((i%2==1)?std::isnan(fn3):(fn3==20.),what+" fn3");
+        check(T==.5*i,what+" T");
+        check(iterations==(int32_t)(2*i),what+" iterations");
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include "dual.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+const double tol=1e-12;
+
+/***************************************************/
+void check_jet(const Dual<3> &a, const double d0, const double d1, const double d2,
+               const double d3, const string &what)
+{
+    check_near(a.derivative(0),d0,tol*(1.+fabs(d0)),what+" value");
+    check_near(a.derivative(1),d1,tol*(1.+fabs(d1)),what+" 1st derivative");
+    check_near(a.derivative(2),d2,tol*(1.+fabs(d2)),what+" 2nd derivative");
+    check_near(a.derivative(3),d3,tol*(1.+fabs(d3)),what+" 3rd derivative");
+}
+
+/***************************************************/
+void check_same(const Dual<3> &a, const Dual<3> &b, const string &what)
+{
+    for (size_t k=0; k<=3; k++) {
+        check_near(a.c[k],b.c[k],tol*(1.+fabs(b.c[k])),what+" c["+to_string(k)+"]");
+    }
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    auto d0=Dual<0>::variable(.3);
+    check(d0.value()==.3,"variable of order 0");
+
+    for (double t=-3.; t<=3.; t+=.25) {
+        auto what="t="+to_string(t);
+        auto x=Dual<3>::variable(t);
+        check_jet(x,t,1.,0.,0.,what+" variable");
+        check_jet(Dual<3>(t),t,0.,0.,0.,what+" constant");
+
+        auto s=sin(t);
+        auto c=cos(t);
+
+        // exp(sin(t)), through sincos and exp
+        Dual<3> sx,cx;
+        sincos(x,sx,cx);
+        auto e=exp(sx);
+        auto f=exp(s);
+        check_jet(e,f,c*f,(c*c-s)*f,(c*c*c-3.*s*c-c)*f,what+" exp(sin(t))");
+        check_same(scaled_exp(sx,2.5),2.5*e,what+" scaled_exp");
+
+        // sin(t^2), through sqr and sincos with aliased outputs
+        auto y=sqr(x);
+        check_same(y,x*x,what+" sqr");
+        Dual<3> cy;
+        sincos(y,y,cy);
+        auto s2=sin(t*t);
+        auto c2=cos(t*t);
+        check_jet(y,s2,2.*t*c2,2.*c2-4.*t*t*s2,-12.*t*s2-8.*t*t*t*c2,what+" sin(t^2)");
+
+        // sqrt(1+t^2)
+        auto g=sqrt(1.+x*x);
+        auto gv=sqrt(1.+t*t);
+        check_jet(g,gv,t/gv,1./pow(gv,3.),-3.*t/pow(gv,5.),what+" sqrt(1+t^2)");
+
+        // 1/(2+cos(t))
+        auto h=Dual<3>(1.)/(2.+cx);
+        auto q=2.+c;
+        check_jet(h,1./q,s/(q*q),c/(q*q)+2.*s*s/pow(q,3.),
+                  -s/(q*q)+6.*s*c/pow(q,3.)+6.*s*s*s/pow(q,4.),what+" 1/(2+cos(t))");
+        check_same(h*(2.+cx),Dual<3>(1.),what+" division");
+
+        // exp expanded at sin(t) composed with sin(t) yields exp(sin(t))
+        check_same(compose(exp(Dual<3>::variable(s)),sx),e,what+" compose");
+
+        // helpers over the orders
+        auto de=derivative(e);
+        auto te=truncate<2>(e);
+        for (size_t k=0; k<=2; k++) {
+            check_near(de.derivative(k),e.derivative(k+1),tol*(1.+fabs(e.derivative(k+1))),
+                       what+" derivative");
+            check(te.c[k]==e.c[k],what+" truncate");
+        }
+    }
+    return EXIT_SUCCESS;
+}
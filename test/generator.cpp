@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "problem.h"
+#include "generator.h"
+#include "pool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+void check_same(const Problem& a, const Problem& b, const string& what)
+{
+    // the stream must be reproducible bit by bit
+    check(a.get_shape()==b.get_shape(),what+" shape");
+    check(a.get_widths()==b.get_widths(),what+" widths");
+    check(a.get_friction()==b.get_friction(),what+" friction");
+    check((a.get_F().t==b.get_F().t) && (a.get_F().fn==b.get_F().fn) &&
+          (a.get_F().ft==b.get_F().ft),what+" load");
+    check((a.eval_COM().x==b.eval_COM().x) && (a.eval_COM().y==b.eval_COM().y),what+" COM");
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    const size_t n=1000;
+    for (size_t num_lobes:{4,7}) {
+        const uint64_t seed=12345+num_lobes;
+        auto what="num_lobes="+to_string(num_lobes);
+
+        // reference stream, one problem at a time
+        Generator generator(seed,num_lobes);
+        vector<Problem> reference(n);
+        for (size_t i=0; i<n; i++) {
+            generator.generate_at(i,reference[i]);
+        }
+
+        // bulk generation, serial and split over pools of different
+        // sizes, also resuming from the middle of the stream
+        for (size_t num_workers:{0,1,3,8}) {
+            ThreadPool pool(std::max<size_t>(num_workers,1));
+            auto pool_what=what+" workers="+to_string(num_workers);
+            Generator bulk(seed,num_lobes);
+            vector<Problem> first(n/3), second(n-n/3);
+            bulk.generate_n(first,(num_workers>0?&pool:nullptr));
+            check(bulk.tell()==n/3,pool_what+" tell after first chunk");
+            bulk.generate_n(second,(num_workers>0?&pool:nullptr));
+            check(bulk.tell()==n,pool_what+" tell after second chunk");
+            for (size_t i=0; i<n; i++) {
+                const auto &p=(i<n/3?first[i]:second[i-n/3]);
+                check_same(p,reference[i],pool_what+" problem="+to_string(i));
+            }
+        }
+
+        // seek/tell round-trip and the sequential generate()
+        Generator stream(seed,num_lobes);
+        check(stream.get_seed()==seed,what+" seed");
+        check(stream.tell()==0,what+" tell at start");
+        for (uint64_t index:{uint64_t(0),uint64_t(7),uint64_t(n-1),uint64_t(3),uint64_t(500)}) {
+            stream.seek(index);
+            check(stream.tell()==index,what+" tell after seek");
+            Problem problem;
+            stream.generate(problem);
+            check(stream.tell()==index+1,what+" tell after generate");
+            check_same(problem,reference[index],what+" seek="+to_string(index));
+        }
+
+        // another seed yields another stream
+        Problem other;
+        Generator(seed+1,num_lobes).generate_at(0,other);
+        check(other.get_shape()!=reference[0].get_shape(),what+" seeds differ");
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include "problem.h"
+#include "generator.h"
+#include "solver.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/**
+ * Expose the callbacks of the NLP, which Ipopt would call.
+ */
+struct GraspCallbacks : public Grasp {
+    using Grasp::Grasp;
+    using Grasp::get_nlp_info;
+    using Grasp::get_starting_point;
+    using Grasp::eval_grad_f;
+    using Grasp::eval_g;
+    using Grasp::eval_jac_g;
+    using Grasp::eval_h;
+};
+
+/***************************************************/
+void check_derivatives(GraspCallbacks& nlp, mt19937& rng, const string& what)
+{
+    Ipopt::Index n,m,nnz_jac,nnz_h;
+    Ipopt::TNLP::IndexStyleEnum style;
+    check(nlp.get_nlp_info(n,m,nnz_jac,nnz_h,style),what+" get_nlp_info");
+
+    // random point around the starting one, and random multipliers
+    normal_distribution<double> noise(0.,1.);
+    vector<double> x(n),lambda(m);
+    nlp.get_starting_point(n,true,x.data(),false,nullptr,nullptr,m,false,nullptr);
+    for (auto &xi:x) {
+        xi+=.2*noise(rng);
+    }
+    for (auto &l:lambda) {
+        l=noise(rng);
+    }
+    const auto sigma=.7;
+
+    vector<Ipopt::Index> jac_rows(nnz_jac),jac_cols(nnz_jac),h_rows(nnz_h),h_cols(nnz_h);
+    vector<double> jac(nnz_jac),h(nnz_h);
+    nlp.eval_jac_g(n,x.data(),true,m,nnz_jac,jac_rows.data(),jac_cols.data(),nullptr);
+    nlp.eval_h(n,x.data(),true,sigma,m,lambda.data(),true,nnz_h,h_rows.data(),h_cols.data(),nullptr);
+    nlp.eval_jac_g(n,x.data(),true,m,nnz_jac,nullptr,nullptr,jac.data());
+    nlp.eval_h(n,x.data(),false,sigma,m,lambda.data(),true,nnz_h,nullptr,nullptr,h.data());
+
+    // the gradient of the Lagrangian from the analytic first derivatives
+    auto grad_lagrangian=[&](const vector<double>& xx) {
+        vector<double> grad(n),J(nnz_jac);
+        nlp.eval_grad_f(n,xx.data(),true,grad.data());
+        nlp.eval_jac_g(n,xx.data(),false,m,nnz_jac,nullptr,nullptr,J.data());
+        for (auto &g:grad) {
+            g*=sigma;
+        }
+        for (Ipopt::Index k=0; k<nnz_jac; k++) {
+            grad[jac_cols[k]]+=lambda[jac_rows[k]]*J[k];
+        }
+        return grad;
+    };
+
+    const auto step=1e-6;
+    const auto tol=1e-5;
+    vector<double> dense_jac(m*n,0.),dense_h(n*n,0.);
+    for (Ipopt::Index k=0; k<nnz_jac; k++) {
+        dense_jac[jac_rows[k]*n+jac_cols[k]]+=jac[k];
+    }
+    for (Ipopt::Index k=0; k<nnz_h; k++) {
+        check(h_rows[k]>=h_cols[k],what+" Hessian entries in the lower triangle");
+        dense_h[h_rows[k]*n+h_cols[k]]+=h[k];
+    }
+
+    vector<double> g_plus(m),g_minus(m);
+    for (Ipopt::Index j=0; j<n; j++) {
+        auto x_plus=x;
+        auto x_minus=x;
+        x_plus[j]+=step;
+        x_minus[j]-=step;
+
+        nlp.eval_g(n,x_plus.data(),true,m,g_plus.data());
+        nlp.eval_g(n,x_minus.data(),true,m,g_minus.data());
+        for (Ipopt::Index i=0; i<m; i++) {
+            auto fd=(g_plus[i]-g_minus[i])/(2.*step);
+            check_near(dense_jac[i*n+j],fd,tol*(1.+fabs(fd)),
+                       what+" Jacobian("+to_string(i)+","+to_string(j)+")");
+        }
+
+        auto grad_plus=grad_lagrangian(x_plus);
+        auto grad_minus=grad_lagrangian(x_minus);
+        for (Ipopt::Index i=j; i<n; i++) {
+            auto fd=(grad_plus[i]-grad_minus[i])/(2.*step);
+            check_near(dense_h[i*n+j],fd,tol*(1.+fabs(fd)),
+                       what+" Hessian("+to_string(i)+","+to_string(j)+")");
+        }
+    }
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    mt19937 rng(1);
+    Generator generator(1);
+    Problem problem;
+    for (int i=0; i<20; i++) {
+        generator.generate(problem);
+        for (size_t num_contacts=2; num_contacts<=4; num_contacts++) {
+            for (auto parametrization:{Parametrization::angle,Parametrization::arc_length}) {
+                GraspCallbacks nlp(problem,num_contacts,HessianMode::exact,parametrization);
+                check_derivatives(nlp,rng,"problem="+to_string(i)+
+                                  " contacts="+to_string(num_contacts)+
+                                  (parametrization==Parametrization::angle?" angle":" arc_length"));
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "problem.h"
+#include "generator.h"
+#include "contact.h"
+#include "graspmap.h"
+#include "pool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+void check_cell(const GraspMap::Cell& cell, const ContactSolver::Solution& sol,
+                const string& what)
+{
+    check_near(cell.residual,sol.residual,1e-12,what+" residual");
+    check_near(cell.fn1,sol.forces[0].fn,1e-12,what+" fn1");
+    check_near(cell.ft1,sol.forces[0].ft,1e-12,what+" ft1");
+    check_near(cell.fn2,sol.forces[1].fn,1e-12,what+" fn2");
+    check_near(cell.ft2,sol.forces[1].ft,1e-12,what+" ft2");
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    const size_t resolution=24;
+    ThreadPool pool(4);
+    Generator generator(1);
+    for (int n=0; n<20; n++) {
+        Problem problem;
+        generator.generate(problem);
+        auto what="problem="+to_string(n);
+
+        GraspMap map(problem,resolution);
+        GraspMap map_pool(problem,resolution,&pool);
+        check(map.get_resolution()==resolution,what+" resolution");
+
+        auto h=2.*M_PI/resolution;
+        size_t best_i=0, best_j=0;
+        for (size_t i=0; i<resolution; i++) {
+            check_near(map.get_angle(i),i*h,1e-15,what+" angle");
+            for (size_t j=0; j<resolution; j++) {
+                auto cell_what=what+" cell=("+to_string(i)+","+to_string(j)+")";
+                auto sol=ContactSolver::solve_fixed(problem,map.get_angle(i),map.get_angle(j));
+                check_cell(map.at(i,j),sol,cell_what);
+                check_cell(map_pool.at(i,j),sol,cell_what+" pool");
+
+                // the nearest cell is found within half a cell, and across 2*PI
+                auto d1=.49*h*sin(3.*i+j), d2=.49*h*cos(i+5.*j);
+                check(&map.lookup(i*h+d1,j*h+d2)==&map.at(i,j),cell_what+" lookup");
+                check(&map.lookup(i*h+d1-2.*M_PI,j*h+d2+4.*M_PI)==&map.at(i,j),
+                      cell_what+" lookup wrapped");
+
+                if (map.at(i,j).residual<map.at(best_i,best_j).residual) {
+                    best_i=i;
+                    best_j=j;
+                }
+            }
+        }
+
+        // the seed is the cell with the smallest residual, ties aside
+        auto seed=map.get_seed();
+        check(seed.size()==2,what+" seed size");
+        const auto &cell=map.lookup(seed[0].t,seed[1].t);
+        check_near(cell.residual,map.at(best_i,best_j).residual,1e-9,what+" seed residual");
+        check_near(seed[0].fn,cell.fn1,0.,what+" seed fn1");
+        check_near(seed[0].ft,cell.ft1,0.,what+" seed ft1");
+        check_near(seed[1].fn,cell.fn2,0.,what+" seed fn2");
+        check_near(seed[1].ft,cell.ft2,0.,what+" seed ft2");
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "pool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+void check_all_once(ThreadPool& pool, const size_t n, const string& what)
+{
+    vector<atomic<int>> runs(n);
+    for (auto &r:runs) {
+        r=0;
+    }
+    pool.parallel_for(n,[&](const size_t worker, const size_t i) {
+        check(worker<pool.size(),what+" worker index");
+        runs[i]++;
+    });
+    for (size_t i=0; i<n; i++) {
+        check(runs[i]==1,what+" item "+to_string(i)+" run once");
+    }
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    for (size_t num_workers:{1,3,8}) {
+        ThreadPool pool(num_workers);
+        auto what="workers="+to_string(num_workers);
+        for (size_t n:{0,1,7,1000}) {
+            check_all_once(pool,n,what+" n="+to_string(n));
+        }
+
+        // an exception thrown by the work reaches the caller, leaving
+        // the pool usable for the next call
+        for (size_t bad:{0,499,999}) {
+            atomic<int> runs{0};
+            bool caught=false;
+            try {
+                pool.parallel_for(1000,[&](const size_t, const size_t i) {
+                    runs++;
+                    if (i==bad) {
+                        throw runtime_error("item "+to_string(i));
+                    }
+                });
+            } catch (const runtime_error &e) {
+                caught=(string(e.what())=="item "+to_string(bad));
+            }
+            check(caught,what+" exception of item "+to_string(bad)+" rethrown");
+            check((runs>0) && (runs<=1000),what+" items run before the exception");
+            check_all_once(pool,1000,what+" after the exception of item "+to_string(bad));
+        }
+    }
+    return EXIT_SUCCESS;
+}
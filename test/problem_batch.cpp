@@ -0,0 +1,93 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include "problem.h"
+#include "generator.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+void check_batch(const Problem& problem, const vector<double>& t, const string& what)
+{
+    auto n=t.size();
+    vector<double> Px(n),Py(n),Nx(n),Ny(n),Tx(n),Ty(n);
+    problem.eval_batch(t.data(),n,SamplesSoA{Px.data(),Py.data(),Nx.data(),
+                                             Ny.data(),Tx.data(),Ty.data()});
+
+    const double tol=1e-12;
+    for (size_t i=0; i<n; i++) {
+        auto frame=problem.eval_frame(t[i]);
+        auto where=what+" n="+to_string(n)+" i="+to_string(i)+" t="+to_string(t[i]);
+        check_near(Px[i],frame.P.x,tol,where+" Px");
+        check_near(Py[i],frame.P.y,tol,where+" Py");
+        check_near(Nx[i],frame.N.x,tol,where+" Nx");
+        check_near(Ny[i],frame.N.y,tol,where+" Ny");
+        check_near(Tx[i],frame.T.x,tol,where+" Tx");
+        check_near(Ty[i],frame.T.y,tol,where+" Ty");
+    }
+}
+
+/***************************************************/
+void check_problem(const Problem& problem, mt19937& rng, const string& what)
+{
+    // tails of every length wrt the SIMD width, and angles outside [0,2*PI)
+    uniform_real_distribution<double> angle(-4.*M_PI,6.*M_PI);
+    for (size_t n:{1,2,3,4,5,7,8,13,1001}) {
+        vector<double> t(n);
+        for (auto &ti:t) {
+            ti=angle(rng);
+        }
+        check_batch(problem,t,what);
+    }
+
+    // lobe centers and sector boundaries, where the index switches
+    auto K=problem.get_shape().size();
+    vector<double> t;
+    for (size_t k=0; k<=2*K; k++) {
+        t.push_back((M_PI*k)/K);
+        t.push_back(-(M_PI*k)/K);
+        t.push_back((M_PI*k)/K+2.*M_PI);
+    }
+    check_batch(problem,t,what+" boundaries");
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    mt19937 rng(1);
+    uniform_real_distribution<double> width(.05,.5);
+    for (size_t K:{1,3,4,7,12}) {
+        Generator generator(K,K);
+        Problem problem;
+        for (int i=0; i<10; i++) {
+            generator.generate(problem);
+            check_problem(problem,rng,"K="+to_string(K)+" generated");
+
+            // same shape with random lobe widths
+            vector<double> widths(K);
+            for (auto &s:widths) {
+                s=width(rng);
+            }
+            check(problem.configure(problem.get_shape(),widths,problem.get_friction(),
+                                    problem.get_F()),"configure with widths");
+            check_problem(problem,rng,"K="+to_string(K)+" widths");
+        }
+
+        check(problem.configure(vector<double>(K,0.),.5,Force{0.,1.,0.}),"configure circle");
+        check(problem.is_circle(),"circle detected");
+        check_problem(problem,rng,"K="+to_string(K)+" circle");
+    }
+    return EXIT_SUCCESS;
+}
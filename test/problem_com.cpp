@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "problem.h"
+#include "generator.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+/***************************************************/
+Vec2 reference_COM(const Problem& problem)
+{
+    // composite 5-point Gauss-Legendre rule on many panels per sector,
+    // so that the truncation of the lobes at the sector boundaries
+    // falls on the boundaries of the panels
+    static const double x[]={-.90617984593866399280,-.53846931010568309104,0.,
+                             .53846931010568309104,.90617984593866399280};
+    static const double w[]={.23692688505618908751,.47862867049936646804,.56888888888888888889,
+                             .47862867049936646804,.23692688505618908751};
+    const size_t num_panels=256;
+    auto K=problem.get_shape().size();
+    auto h=M_PI/(K*num_panels);
+
+    double area=0.;
+    Vec2 COM;
+    for (size_t j=0; j<K*num_panels; j++) {
+        auto tm=(2.*j+1.)*h;
+        for (size_t i=0; i<5; i++) {
+            auto t=tm+h*x[i];
+            auto r=norm(problem.eval_P(t));
+            area+=h*w[i]*r/2.;
+            COM+=(h*w[i]*r*r/3.)*Vec2(cos(t),sin(t));
+        }
+    }
+    return COM/area;
+}
+
+/***************************************************/
+void check_COM(const Problem& problem, const double tol, const string& what)
+{
+    auto COM=reference_COM(problem);
+    check_near(problem.eval_COM().x,COM.x,tol,what+" COM.x");
+    check_near(problem.eval_COM().y,COM.y,tol,what+" COM.y");
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    for (size_t K:{3,4,7,12,32,64}) {
+        Generator generator(K,K);
+        for (int i=0; i<20; i++) {
+            Problem problem;
+            generator.generate(problem);
+            auto what="K="+to_string(K)+" problem="+to_string(i);
+
+            // default widths
+            check_COM(problem,1e-7,what+" default widths");
+
+            // lobes down to 1/100 of the default width, which a single
+            // rule per sector cannot resolve
+            vector<double> widths(K);
+            for (size_t k=0; k<K; k++) {
+                widths[k]=(.8/K)*pow(10.,-2.*((k+i)%5)/4.);
+            }
+            check(problem.configure(problem.get_shape(),widths,problem.get_friction(),problem.get_F()),
+                  what+" configure narrow widths");
+            check_COM(problem,1e-7,what+" narrow widths");
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include "problem.h"
+#include "generator.h"
+#include "pool.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+const size_t batch_size=7;
+const size_t num_contacts=3;
+
+/**
+ * Everything a task reads out of the shared Problem.
+ */
+struct Sample {
+    Frame frame;
+    double batch[6*batch_size];
+    Vec2 F;
+    double T;
+    vector<Vec2> dF;
+    vector<double> dT;
+};
+
+/***************************************************/
+void compute(const Problem& problem, const vector<double>& t, const size_t i, Sample& s)
+{
+    s.frame=problem.eval_frame(t[i]);
+
+    const auto *tb=&t[i*batch_size%(t.size()-batch_size)];
+    auto *b=s.batch;
+    problem.eval_batch(tb,batch_size,SamplesSoA{b,b+batch_size,b+2*batch_size,b+3*batch_size,
+                                                       b+4*batch_size,b+5*batch_size});
+
+    Force forces[num_contacts];
+    for (size_t k=0; k<num_contacts; k++) {
+        forces[k]=Force{t[(i+k)%t.size()],1.+k,.1*k};
+    }
+    Wrench wrench;
+    problem.eval_wrench(forces,num_contacts,wrench,true);
+    s.F=wrench.F;
+    s.T=wrench.T;
+    s.dF=wrench.dF;
+    s.dT=wrench.dT;
+}
+
+/***************************************************/
+bool same(const Vec2& a, const Vec2& b)
+{
+    return ((a.x==b.x) && (a.y==b.y));
+}
+
+/***************************************************/
+void check_same(const Sample& a, const Sample& b, const string& what)
+{
+    const Vec2 *fa[]={&a.frame.P,&a.frame.dP,&a.frame.d2P,&a.frame.d3P,&a.frame.T,&a.frame.dT,
+                      &a.frame.d2T,&a.frame.N,&a.frame.dN,&a.frame.d2N};
+    const Vec2 *fb[]={&b.frame.P,&b.frame.dP,&b.frame.d2P,&b.frame.d3P,&b.frame.T,&b.frame.dT,
+                      &b.frame.d2T,&b.frame.N,&b.frame.dN,&b.frame.d2N};
+    for (size_t k=0; k<10; k++) {
+        check(same(*fa[k],*fb[k]),what+" eval_frame");
+    }
+    check(equal(begin(a.batch),end(a.batch),begin(b.batch)),what+" eval_batch");
+    check(same(a.F,b.F) && (a.T==b.T),what+" eval_wrench");
+    check((a.dF.size()==b.dF.size()) && equal(begin(a.dF),end(a.dF),begin(b.dF),same) &&
+          (a.dT==b.dT),what+" eval_wrench gradient");
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    // one problem per kind: generated with 4 and 7 lobes, and a circle
+    vector<Problem> problems(3);
+    Generator(1,4).generate(problems[0]);
+    Generator(2,7).generate(problems[1]);
+    check(problems[2].configure(vector<double>(4,0.),.5,Force{1.,1.,.2}),"configure circle");
+
+    mt19937 rng(1);
+    uniform_real_distribution<double> angle(-M_PI,3.*M_PI);
+    const size_t n=4096;
+    vector<double> t(n);
+    for (auto &ti:t) {
+        ti=angle(rng);
+    }
+
+    ThreadPool pool(std::max(4U,thread::hardware_concurrency()));
+    for (size_t p=0; p<problems.size(); p++) {
+        const auto &problem=problems[p];
+        vector<Sample> serial(n);
+        for (size_t i=0; i<n; i++) {
+            compute(problem,t,i,serial[i]);
+        }
+
+        // all the workers read the same problem at once
+        for (int round=0; round<10; round++) {
+            vector<Sample> parallel(n);
+            pool.parallel_for(n,[&](const size_t, const size_t i) {
+                compute(problem,t,i,parallel[i]);
+            });
+            for (size_t i=0; i<n; i++) {
+                check_same(parallel[i],serial[i],"problem="+to_string(p)+
+                           " round="+to_string(round)+" i="+to_string(i));
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "problem.h"
+#include "generator.h"
+#include "solver.h"
+#include "testing.h"
+
+using namespace std;
+using namespace problem_ns;
+using namespace test_ns;
+
+namespace {
+
+// tolerance on the constraints the solver works with
+const double constr_viol_tol=1e-3;
+
+// time granted beyond the budget to the iteration running at the
+// deadline and to the fallback heuristic: the wall time is only a
+// gross check, generous to absorb the noise of loaded machines,
+// whereas the iteration count tells where Ipopt stopped
+const double latency_slack=.5;
+
+/***************************************************/
+void check_forces(const vector<Force>& forces, const size_t num_contacts,
+                  const string& what)
+{
+    check(forces.size()==num_contacts,what+" number of forces");
+    for (auto &f:forces) {
+        check(isfinite(f.t) && isfinite(f.fn) && isfinite(f.ft),what+" finite forces");
+    }
+}
+
+}
+
+/***************************************************/
+int main()
+{
+    Generator generator(3);
+    Problem problem;
+    for (auto hessian:{HessianMode::limited_memory,HessianMode::exact}) {
+        Solver solver(false,hessian);
+        for (int i=0; i<10; i++) {
+            generator.generate(problem);
+            auto what=string(hessian==HessianMode::exact?"exact":"limited_memory")+
+                      " problem="+to_string(i);
+
+            // a budget far shorter than a single iteration stops Ipopt
+            // before convergence: the forces are either the best feasible
+            // iterate met or those of the heuristic
+            const double budget=1e-6;
+            auto forces=solver.compute_within(problem,budget);
+            auto &stats=solver.get_stats();
+            check_forces(forces,2,what+" tight budget");
+            check((stats.quality==SolveQuality::feasible) ||
+                  (stats.quality==SolveQuality::fallback),what+" tight budget quality");
+            check(stats.status!=Ipopt::SUCCESS,what+" tight budget status");
+            check(stats.iterations<=1,what+" tight budget iterations");
+            if (stats.quality==SolveQuality::feasible) {
+                check(stats.constr_viol<=constr_viol_tol,what+" feasible constraints");
+            }
+            check(stats.wall_time<budget+latency_slack,what+" tight budget latency");
+
+            // with time to spare the solver does not fall short of its
+            // own guarantees
+            forces=solver.compute_within(problem,10.);
+            check_forces(forces,2,what+" loose budget");
+            if (stats.quality==SolveQuality::converged) {
+                check((stats.status==Ipopt::SUCCESS) ||
+                      (stats.status==Ipopt::STOP_AT_ACCEPTABLE_POINT),
+                      what+" converged status");
+            } else if (stats.quality==SolveQuality::feasible) {
+                check(stats.constr_viol<=constr_viol_tol,what+" loose feasible constraints");
+            }
+        }
+    }
+
+    // circles are solved in closed form whatever the budget
+    Problem circle;
+    check(circle.configure(vector<double>(4,0.),.5,Force{0.,1.,0.}),"configure circle");
+    Solver solver;
+    auto forces=solver.compute_within(circle,1e-9);
+    check_forces(forces,2,"circle");
+    check(solver.get_stats().quality==SolveQuality::converged,"circle quality");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+// -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*-
+//
+// Author: Ugo Pattacini - <ugo.pattacini@iit.it>
+
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+namespace test_ns {
+
+/**
+ * Make the test fail when the condition does not hold.
+ * @param condition is the condition to check.
+ * @param what describes the check.
+ */
+inline void check(const bool condition, const std::string &what)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Make the test fail when two quantities differ by more than a tolerance.
+ * @param a is the first quantity.
+ * @param b is the second quantity.
+ * @param tol is the absolute tolerance.
+ * @param what describes the check.
+ */
+inline void check_near(const double a, const double b, const double tol,
+                       const std::string &what)
+{
+    if (!(std::fabs(a-b)<=tol)) {
+        std::cerr << std::setprecision(17) << "FAILED: " << what << ": " << a << " vs " << b
+                  << " (tol=" << tol << ")" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+}
+
+#endif